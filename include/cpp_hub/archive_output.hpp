@@ -0,0 +1,119 @@
+// include/cpp_hub/archive_output.hpp
+#pragma once
+
+#include "cpp_hub/output_backend.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace cpp_hub {
+
+class ArchiveSink;
+
+// Output backend writing the rendered tree as a POSIX (ustar, with pax
+// headers for long names and huge files) tar stream instead of touching
+// the filesystem. Member names are the destination paths relative to the
+// parent of the render's target root, so the archive unpacks into a
+// directory named like the target.
+//
+// The archive is reproducible: file members appear in render order (by
+// tag), whatever order the files complete in, and every member carries the
+// same modification time.
+class ArchiveOutput final : public OutputBackend {
+public:
+    // Write to `archive`, or to standard output if it is "-", stamping
+    // members with `mtime` (seconds since the epoch). With `zstd` the stream
+    // is zstd-compressed, using up to `jobs` threads.
+    // Returns nullptr (with error set) if the archive cannot be created or
+    // zstd is not available in this build.
+    static std::unique_ptr<ArchiveOutput> create(
+        const std::filesystem::path& archive,
+        const std::filesystem::path& targetRoot,
+        std::int64_t mtime,
+        bool zstd,
+        unsigned jobs,
+        std::string& error);
+
+    // True if this build can write zstd-compressed archives.
+    static bool zstd_available();
+
+    ~ArchiveOutput() override;
+
+    const char* name() const override { return "archive"; }
+
+    bool create_directories(const std::vector<std::filesystem::path>& dirs,
+                            std::string& error) override;
+    bool write_file(std::size_t tag, const std::filesystem::path& dest, std::string& data,
+                    std::filesystem::perms perms, std::string& error) override;
+    bool copy_file(std::size_t tag, const std::filesystem::path& src,
+                   const std::filesystem::path& dest, std::string_view content,
+                   std::filesystem::perms perms, std::string& error) override;
+    std::unique_ptr<OutputStream> open_stream(std::size_t tag, const std::filesystem::path& dest,
+                                              std::filesystem::perms perms,
+                                              std::string& error) override;
+    std::vector<OutputFailure> finish() override { return {}; }
+
+    // Write the end-of-archive marker and flush everything. Must be called
+    // once rendering has succeeded; an archive that is not closed is
+    // incomplete.
+    bool close(std::string& error);
+
+    // Append one regular file member holding the `size` bytes of `spool`,
+    // which is rewound and whose ownership passes to the archive. Used by
+    // the streams, which only know the size (needed in the header) once all
+    // of the file has been spooled.
+    bool append_file(std::size_t tag, const std::filesystem::path& dest, std::uint64_t size,
+                     std::filesystem::perms perms, std::FILE* spool, std::string& error);
+
+private:
+    // A file that completed before every file with a lower tag did. Its
+    // bytes are in exactly one of data, mapped and spool.
+    struct PendingMember {
+        PendingMember(std::string name, std::uint64_t size, unsigned mode)
+            : name(std::move(name)), size(size), mode(mode) {}
+
+        std::string name;
+        std::uint64_t size;
+        unsigned mode;
+        std::string data;
+        util::MappedFile mapped;
+        std::FILE* spool = nullptr;
+    };
+
+    ArchiveOutput(std::unique_ptr<ArchiveSink> sink, std::filesystem::path root,
+                  std::int64_t mtime);
+
+    std::string member_name(const std::filesystem::path& dest) const;
+    bool put_header(const std::string& name, char type, std::uint64_t size, unsigned mode,
+                    std::string& error);
+    bool put_data(std::string_view data, std::string& error);
+    bool put_padding(std::uint64_t size, std::string& error);
+    bool put_spooled(const std::string& name, std::uint64_t size, unsigned mode,
+                     std::FILE* spool, std::string& error);
+    bool put_pending(PendingMember& member, std::string& error);
+    // Hold back the member of `tag`, or write it and every held-back member
+    // that may now follow it. Called with mutex_ held.
+    bool add_member(std::size_t tag, PendingMember member, std::string& error);
+    bool flush_pending(std::string& error);
+
+    std::unique_ptr<ArchiveSink> sink_;
+    std::filesystem::path root_; // members are named relative to this
+    std::int64_t mtime_;
+    std::mutex mutex_;
+    std::unordered_set<std::string> directories_;
+    std::size_t nextTag_ = 0;
+    std::map<std::size_t, PendingMember> pending_;
+    std::uint64_t pendingBytes_ = 0;      // held in PendingMember::data
+    std::vector<std::string> spareBuffers_; // recycled PendingMember::data
+};
+
+} // namespace cpp_hub
@@ -10,7 +10,11 @@ std::string default_registry_url();
 
 std::filesystem::path config_root();
 std::filesystem::path registry_path();
+std::filesystem::path registries_config_path();
+std::filesystem::path registries_root();
 std::filesystem::path cache_root();
+std::filesystem::path compiled_cache_root();
+std::filesystem::path objects_root();
 
 std::string version();
 
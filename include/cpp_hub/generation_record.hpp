@@ -0,0 +1,125 @@
+// include/cpp_hub/generation_record.hpp
+#pragma once
+
+#include "cpp_hub/output_backend.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// Where the record is kept, relative to the generated project's root.
+inline constexpr std::string_view kGenerationRecordPath = ".cpp-hub/generation.json";
+
+// What a project was generated from and what came out of it. Written into
+// the project by render_layers (when RenderOptions::record is set) and read
+// back by `cpp-hub regen`.
+struct GenerationRecord {
+    std::string templatePath;   // template checkout the project came from
+    std::string templateCommit; // its HEAD at the time, empty if not a git checkout
+    std::map<std::string, std::string> variables;
+    std::vector<std::string> overlays; // active overlay paths, as in the manifest
+    // Content hash of every generated file, keyed by its path relative to
+    // the project root ('/'-separated).
+    std::map<std::string, std::string> files;
+    // Permission bits of every generated file, with the same keys. Records
+    // written by older versions of cpp-hub have none.
+    std::map<std::string, std::filesystem::perms> modes;
+};
+
+// What regenerating a project over its previous record did.
+struct RegenSummary {
+    std::size_t written = 0;   // outputs that are new or whose content or mode changed
+    std::size_t unchanged = 0; // outputs generated exactly as before
+    std::size_t removed = 0;   // outputs the template no longer produces
+    // Outputs left alone because they were edited (or deleted) since they
+    // were generated, sorted.
+    std::vector<std::string> kept;
+};
+
+// Throws std::runtime_error if the project has no readable record.
+GenerationRecord load_generation_record(const std::filesystem::path& projectRoot);
+
+// Throws std::runtime_error if the record cannot be written.
+void save_generation_record(const std::filesystem::path& projectRoot,
+                            const GenerationRecord& record);
+
+// Content hash stored in records, e.g. "fnv1a64:0123456789abcdef".
+std::string content_hash(std::string_view data);
+// The same hash before formatting.
+std::uint64_t content_digest(std::string_view data);
+
+// Hash of a file's contents, and optionally its permission bits; returns
+// false if it cannot be read.
+bool hash_file(const std::filesystem::path& file, std::string& hash,
+               std::filesystem::perms* perms = nullptr);
+
+// Output backend that hashes every file on its way to `inner`, for the
+// record. Given the previous record of targetRoot, it also turns a render
+// into a regeneration: outputs whose content and mode are unchanged are not
+// written, and neither are files the user edited (or chmod'ed) since they
+// were generated.
+class RecordingOutput final : public OutputBackend {
+public:
+    RecordingOutput(OutputBackend& inner,
+                    std::filesystem::path targetRoot,
+                    const GenerationRecord* previous);
+
+    const char* name() const override { return inner_.name(); }
+
+    bool create_directories(const std::vector<std::filesystem::path>& dirs,
+                            std::string& error) override;
+    bool write_file(std::size_t tag, const std::filesystem::path& dest, std::string& data,
+                    std::filesystem::perms perms, std::string& error) override;
+    bool copy_file(std::size_t tag, const std::filesystem::path& src,
+                   const std::filesystem::path& dest, std::string_view content,
+                   std::filesystem::perms perms, std::string& error) override;
+    bool copy_known_file(std::size_t tag, const std::filesystem::path& src,
+                         const std::filesystem::path& dest, std::string_view content,
+                         std::uint64_t digest, std::filesystem::perms perms,
+                         std::string& error) override;
+    std::unique_ptr<OutputStream> open_stream(std::size_t tag, const std::filesystem::path& dest,
+                                              std::filesystem::perms perms,
+                                              std::string& error) override;
+    std::vector<OutputFailure> finish() override;
+
+    // Once rendering has succeeded: remove previous outputs the template no
+    // longer produces (unless edited) and store the file hashes in record.
+    bool complete(GenerationRecord& record, RegenSummary* summary, std::string& error);
+
+    // Decide whether dest, generated with the given content hash (see
+    // content_hash, before formatting) and permissions, must be written, and
+    // note what the record should say about it. Used by the streams.
+    bool claim(const std::filesystem::path& dest, std::uint64_t hash,
+               std::filesystem::perms perms);
+
+private:
+    struct Output {
+        std::uint64_t hash;
+        std::filesystem::perms perms;
+    };
+
+    std::string key_of(const std::filesystem::path& dest) const;
+    std::filesystem::perms previous_mode(const std::string& rel,
+                                         const std::filesystem::path& dest) const;
+
+    OutputBackend& inner_;
+    std::filesystem::path targetRoot_;
+    std::filesystem::path::string_type rootPrefix_; // targetRoot_ with a trailing separator
+    const GenerationRecord* previous_;
+
+    // Hashes are formatted only once the render is complete.
+    std::mutex mutex_;
+    std::map<std::string, Output> files_;
+    std::map<std::string, std::string> keptHashes_; // edited files: their recorded hash
+    std::map<std::string, std::filesystem::perms> keptModes_; // ... and mode, if recorded
+    RegenSummary summary_;
+};
+
+} // namespace cpp_hub
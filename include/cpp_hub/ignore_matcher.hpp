@@ -0,0 +1,71 @@
+// include/cpp_hub/ignore_matcher.hpp
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_hub {
+
+struct TemplateManifest;
+
+// Per-template ignore file, read from the template root.
+inline constexpr std::string_view kIgnoreFileName = ".hubignore";
+
+// Template paths that are never generated, given as gitignore-style
+// patterns: `*`, `?`, `[...]` and `**` globs, a trailing `/` for
+// directories only, a leading `!` to re-include, and patterns containing a
+// `/` anchored at the template root (others match a name at any depth).
+// The last matching pattern wins. An ignored directory is pruned as a
+// whole, so nothing underneath it can be re-included.
+//
+// Patterns are compiled once: literal ones are looked up in hash tables
+// (by name, or by full path if anchored) and only the remaining globs are
+// tried, newest first, for as long as they could still override a match.
+class IgnoreMatcher {
+public:
+    IgnoreMatcher() = default;
+    explicit IgnoreMatcher(const std::vector<std::string>& patterns);
+
+    IgnoreMatcher(const IgnoreMatcher&) = delete;
+    IgnoreMatcher& operator=(const IgnoreMatcher&) = delete;
+    IgnoreMatcher(IgnoreMatcher&&) = default;
+    IgnoreMatcher& operator=(IgnoreMatcher&&) = default;
+
+    bool empty() const { return rules_.empty(); }
+
+    // relPath is '/'-separated and relative to the template root.
+    bool ignored(std::string_view relPath, bool directory) const;
+
+private:
+    struct Rule {
+        std::string glob;
+        bool negated = false;
+        bool directoryOnly = false;
+        bool anchored = false; // matched against the whole path, not the name
+    };
+
+    void consider(const std::vector<std::uint32_t>* candidates, bool directory,
+                  std::int64_t& best) const;
+
+    std::vector<Rule> rules_;
+    // Literal patterns, keyed by the rule's glob; values are rule indices.
+    std::unordered_map<std::string_view, std::vector<std::uint32_t>> names_;
+    std::unordered_map<std::string_view, std::vector<std::uint32_t>> paths_;
+    std::vector<std::uint32_t> globs_; // all other rules, in order
+};
+
+// Match text against a single glob, where `*`, `?` and classes never match
+// a '/' and a `**` path component matches any number of components.
+bool glob_match(std::string_view glob, std::string_view text);
+
+// The template's ignore patterns: the manifest's `ignore` list followed by
+// the lines of its .hubignore, if there is one. Throws std::runtime_error
+// if the file exists but cannot be read.
+std::vector<std::string> load_ignore_patterns(const std::filesystem::path& templateRoot,
+                                              const TemplateManifest& manifest);
+
+} // namespace cpp_hub
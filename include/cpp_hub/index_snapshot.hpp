@@ -0,0 +1,185 @@
+// include/cpp_hub/index_snapshot.hpp
+#pragma once
+
+#include "cpp_hub/search_index.hpp"
+#include "cpp_hub/tag_index.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// A template as read from index.json.
+struct TemplateInfo {
+    std::string id;
+    std::string name;
+    std::string description;
+    std::string url;
+    std::vector<std::string> tags;
+    std::string buildSystem;
+    std::string revision; // optional; changes when the template's repository does
+};
+
+// A string in the snapshot's string table.
+struct PackedString {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+// Tags and build systems repeat across most templates, so each distinct
+// one is stored once in the snapshot's symbol list and referred to by its
+// index there.
+struct PackedTemplate {
+    PackedString id;
+    PackedString name;
+    PackedString description;
+    PackedString url;
+    PackedString revision;
+    std::uint32_t buildSystem; // symbol
+    std::uint32_t firstTag;    // index into the snapshot's tag list of symbols
+    std::uint32_t tagCount;
+};
+
+// One registry template; views into storage owned by the Registry, valid
+// until it is reloaded.
+class TemplateView {
+public:
+    TemplateView(const PackedTemplate& t, std::span<const PackedString> symbols,
+                 std::span<const std::uint32_t> tags, std::string_view strings)
+        : t_(&t), symbols_(symbols), tags_(tags.subspan(t.firstTag, t.tagCount)),
+          strings_(strings) {}
+
+    std::string_view id() const { return str(t_->id); }
+    std::string_view name() const { return str(t_->name); }
+    std::string_view description() const { return str(t_->description); }
+    std::string_view url() const { return str(t_->url); }
+    std::string_view revision() const { return str(t_->revision); }
+    std::string_view build_system() const { return str(symbols_[t_->buildSystem]); }
+
+    std::size_t tag_count() const { return tags_.size(); }
+    std::string_view tag(std::size_t i) const { return str(symbols_[tags_[i]]); }
+
+    // Interned ids of the build system and tags: within one index file,
+    // equal ids mean equal strings.
+    std::uint32_t build_system_id() const { return t_->buildSystem; }
+    std::uint32_t tag_id(std::size_t i) const { return tags_[i]; }
+
+private:
+    std::string_view str(PackedString s) const { return strings_.substr(s.offset, s.length); }
+
+    const PackedTemplate* t_;
+    std::span<const PackedString> symbols_;
+    std::span<const std::uint32_t> tags_;
+    std::string_view strings_;
+};
+
+// Tag filter for Registry::with_tags, compared case-insensitively: the
+// templates with every tag in `all`, at least one in `any` (unless it is
+// empty) and none in `none`.
+struct TagQuery {
+    std::vector<std::string> all;
+    std::vector<std::string> any;
+    std::vector<std::string> none;
+};
+
+struct SearchHit {
+    std::size_t ordinal;
+    double score;
+};
+
+// The corpus statistics search scores are computed against. A sharded
+// registry pools those of its shards, so that its ranking does not depend
+// on how it is split.
+struct SearchStats {
+    double templates = 0;
+    double lengths[kSearchFieldCount] = {}; // total length of each field
+    std::vector<double> frequencies;        // document frequency of each query word
+};
+
+// Order hits best first (ties by ordinal) and keep at most `limit` of them
+// (all if limit is 0). Used to combine the hits of several indexes.
+void rank_hits(std::vector<SearchHit>& hits, std::size_t limit);
+
+// One index file of a registry (its index.json, or one shard of a sharded
+// registry) in binary snapshot form: a string table, the templates sorted
+// by id, the interned tags and build systems, the templates' tag lists, a
+// trigram index for search and a bitmap per tag. The snapshot is stored
+// next to the clone, keyed by the size and modification time of the index
+// file, and later runs map it read-only instead of parsing JSON.
+class IndexSnapshot {
+public:
+    // Return the snapshot of indexFile, (re)building snapshotFile when it is
+    // missing, unreadable, or was built from a different version of the
+    // index. For a shard, pass its name and the registry's prefix length:
+    // templates whose id does not start with the shard name are skipped.
+    // Throws std::runtime_error if the index cannot be read or is invalid.
+    static std::unique_ptr<IndexSnapshot> load_or_build(
+        const std::filesystem::path& indexFile,
+        const std::filesystem::path& snapshotFile,
+        std::string_view shard = {},
+        std::size_t prefixLength = 0);
+
+    const std::string& registry_name() const { return registryName_; }
+    // For the index.json of a sharded registry, which lists no templates:
+    // the length of the id prefix that names each shard. Otherwise 0.
+    std::size_t shard_prefix_length() const { return prefixLength_; }
+
+    // Templates in id order.
+    std::size_t size() const { return templates_.size(); }
+    TemplateView at(std::size_t i) const { return {templates_[i], symbols_, tags_, strings_}; }
+    std::optional<TemplateView> find(std::string_view id) const;
+    // Templates whose id, name, description or one of whose tags contains
+    // query, ignoring ASCII case, best first: scored with BM25F over the
+    // query's words, plus a bonus for fields equal to the whole query.
+    // With a limit, only the best `limit` hits are kept and sorted.
+    // Templates rejected by `accept` are neither scored nor counted. Scores
+    // use `stats` if given, else this index's own statistics.
+    std::vector<SearchHit> search(
+        std::string_view query,
+        std::size_t limit = 0,
+        const std::function<bool(std::size_t)>& accept = {},
+        const SearchStats* stats = nullptr) const;
+    // Add this index's statistics for query to stats.
+    void add_search_stats(std::string_view query, SearchStats& stats) const;
+    // Ordinals of the templates matching query; ascending.
+    std::vector<std::size_t> with_tags(const TagQuery& query) const;
+
+private:
+    // What the snapshot was built from.
+    struct IndexStamp {
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::string shard;
+        std::uint32_t shardPrefixLength;
+        bool operator==(const IndexStamp&) const = default;
+    };
+
+    IndexSnapshot() = default;
+
+    static std::string build(const std::filesystem::path& indexFile, const IndexStamp& stamp);
+    // Decode data (which must outlive *this); throws on malformed input.
+    // Returns the stamp of the index file it was built from.
+    IndexStamp decode(std::string_view data);
+
+    std::string registryName_;
+    std::size_t prefixLength_ = 0;
+    std::span<const PackedTemplate> templates_;
+    std::span<const PackedString> symbols_;
+    std::span<const std::uint32_t> tags_;
+    std::string_view strings_;
+    TrigramIndex search_;
+    TagIndex tagIndex_;
+
+    util::MappedFile file_; // backing storage when loaded from disk
+    std::string owned_;     // backing storage when freshly built
+};
+
+} // namespace cpp_hub
@@ -0,0 +1,46 @@
+// include/cpp_hub/object_store.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace cpp_hub {
+
+// Content-addressed store of template files under ~/.cpp-hub/objects.
+//
+// Cached template checkouts are turned into hard-link farms into the store:
+// every regular file outside .git becomes a link to the object with the same
+// content and permission bits, so a file shared by several templates,
+// branches or revisions is stored once. Objects are named by content hash,
+// size and permissions, and contents are compared byte for byte before a
+// file is linked to an existing object, so a hash collision only costs the
+// sharing. Git replaces files rather than rewriting them in place, so pulls
+// and checkouts in a cached clone never change the objects.
+class ObjectStore {
+public:
+    struct AbsorbStats {
+        std::size_t files = 0;       // regular files seen
+        std::size_t stored = 0;      // became new objects
+        std::size_t shared = 0;      // replaced by a link to an existing object
+        std::uint64_t savedBytes = 0; // size of the shared files
+    };
+
+    explicit ObjectStore(std::filesystem::path root);
+
+    const std::filesystem::path& root() const { return root_; }
+
+    // Link every regular file of tree (except under .git) into the store,
+    // on up to `jobs` threads (0 selects the default). Files that cannot be
+    // linked, e.g. because the store is on another file system, are left
+    // as they are.
+    AbsorbStats absorb(const std::filesystem::path& tree, unsigned jobs = 0) const;
+
+    // Delete objects no cached file links to any more; returns how many.
+    std::size_t prune() const;
+
+private:
+    std::filesystem::path root_;
+};
+
+} // namespace cpp_hub
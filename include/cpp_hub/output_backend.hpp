@@ -0,0 +1,111 @@
+// include/cpp_hub/output_backend.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// A write that failed after it was accepted by an asynchronous backend.
+struct OutputFailure {
+    std::size_t tag; // tag passed with the write
+    std::string message;
+};
+
+// Incremental writer for a file too large to hand over in one piece.
+class OutputStream {
+public:
+    virtual ~OutputStream() = default;
+    virtual bool write(std::string_view data, std::string& error) = 0;
+    // Complete the file. Must be called (and succeed) for the file to count
+    // as written.
+    virtual bool close(std::string& error) = 0;
+};
+
+// Where the renderer puts generated directories and files. write_file and
+// copy_file may be called from several threads at once. A backend may
+// complete writes asynchronously: errors it cannot report right away are
+// returned by finish(), identified by the caller-supplied tag. The renderer
+// numbers its files 0, 1, 2, ... in render order and uses each number as
+// the tag of exactly one write_file, copy_file or open_stream call.
+class OutputBackend {
+public:
+    virtual ~OutputBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Create every directory in dirs (and any missing parents). Parents must
+    // be listed before their children.
+    virtual bool create_directories(
+        const std::vector<std::filesystem::path>& dirs,
+        std::string& error) = 0;
+
+    // Create or truncate dest with the given contents and permission bits.
+    // A backend that writes asynchronously takes data's buffer rather than
+    // copying it, and leaves a cleared buffer of its own in its place, so a
+    // caller reusing one buffer for every file does not allocate.
+    virtual bool write_file(
+        std::size_t tag,
+        const std::filesystem::path& dest,
+        std::string& data,
+        std::filesystem::perms perms,
+        std::string& error) = 0;
+
+    // Copy src to dest verbatim, keeping its permission bits. If the caller
+    // already has the source mapped, `content` holds its bytes (and `perms`
+    // its permission bits); otherwise content is empty.
+    virtual bool copy_file(
+        std::size_t tag,
+        const std::filesystem::path& src,
+        const std::filesystem::path& dest,
+        std::string_view content,
+        std::filesystem::perms perms,
+        std::string& error) = 0;
+
+    // copy_file for a source whose content digest (see content_digest) the
+    // caller already knows, so that a backend needing it does not have to
+    // read the file. Backends that have no use for it just copy.
+    virtual bool copy_known_file(
+        std::size_t tag,
+        const std::filesystem::path& src,
+        const std::filesystem::path& dest,
+        std::string_view content,
+        std::uint64_t digest,
+        std::filesystem::perms perms,
+        std::string& error) {
+        (void)digest;
+        return copy_file(tag, src, dest, content, perms, error);
+    }
+
+    // Start writing dest piece by piece. Returns nullptr (with error set) if
+    // it cannot be created. Streams complete synchronously.
+    virtual std::unique_ptr<OutputStream> open_stream(
+        std::size_t tag,
+        const std::filesystem::path& dest,
+        std::filesystem::perms perms,
+        std::string& error) = 0;
+
+    // Wait for all outstanding work and return the writes that failed.
+    virtual std::vector<OutputFailure> finish() = 0;
+};
+
+// Stream writing straight to dest, as used by the built-in backends.
+std::unique_ptr<OutputStream> open_file_stream(
+    const std::filesystem::path& dest,
+    std::filesystem::perms perms,
+    std::string& error);
+
+// Synchronous backend issuing plain POSIX calls (or their std equivalents).
+std::unique_ptr<OutputBackend> make_posix_output();
+
+// Backend batching mkdir/open/write/close through io_uring. Returns nullptr
+// when the kernel (or platform) does not support the operations it needs.
+// With `overwrite`, files may already exist, and their modes are reset.
+std::unique_ptr<OutputBackend> make_io_uring_output(bool overwrite);
+
+} // namespace cpp_hub
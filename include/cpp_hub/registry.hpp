@@ -1,42 +1,70 @@
 // include/cpp_hub/registry.hpp
 #pragma once
 
+#include "cpp_hub/index_snapshot.hpp"
+
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace cpp_hub {
 
-struct TemplateInfo {
-    std::string id;
-    std::string name;
-    std::string description;
-    std::string url;
-    std::vector<std::string> tags;
-    std::string buildSystem;
-};
-
+// The local registry clone and its template index.
+//
+// The index is either a single index.json or, for large registries,
+// sharded: an index.json giving the length of the id prefix that names a
+// shard, plus one index/<prefix>.json per prefix. Every index file is read
+// through its snapshot (see IndexSnapshot). Looking up a template opens
+// only the shard that can hold it; the rest are loaded the first time the
+// whole registry is enumerated. That happens lazily, from const methods,
+// so a Registry must not be used by several threads at once.
 class Registry {
 public:
-    Registry();
+    Registry(); // the default registry
+    Registry(std::filesystem::path path, std::string url);
 
     void ensure_initialized(); // clone if necessary, load index
     void update();             // git pull (or clone if missing), reload
     void reload();             // reload index.json (no git network access)
 
     const std::filesystem::path& path() const;
+    const std::string& url() const { return url_; }
     const std::string& name() const;
-    const std::map<std::string, TemplateInfo>& templates() const;
-    const TemplateInfo* find_template(const std::string& id) const;
+    bool sharded() const { return root_ && root_->shard_prefix_length() != 0; }
+
+    // Templates in id order.
+    std::size_t size() const;
+    TemplateView at(std::size_t i) const;
+    std::optional<TemplateView> find_template(std::string_view id) const;
+    // As IndexSnapshot::search and IndexSnapshot::with_tags, over all
+    // index files.
+    std::vector<SearchHit> search(
+        std::string_view query,
+        std::size_t limit = 0,
+        const std::function<bool(std::size_t)>& accept = {}) const;
+    std::vector<std::size_t> with_tags(const TagQuery& query) const;
 
 private:
+    const IndexSnapshot* shard(const std::string& key) const;
+    void enumerate() const;
+
     std::filesystem::path registryPath_;
-    std::string registryName_;
-    std::map<std::string, TemplateInfo> templates_;
+    std::string url_;
     bool loaded_;
 
-    void load_index();
+    std::unique_ptr<IndexSnapshot> root_; // index.json
+    // Shards by name, loaded on demand; null if there is no such shard.
+    mutable std::map<std::string, std::unique_ptr<IndexSnapshot>, std::less<>> shards_;
+    // Once enumerated: every index file holding templates, in id order,
+    // and the ordinal each starts at (plus the total at the end).
+    mutable std::vector<const IndexSnapshot*> parts_;
+    mutable std::vector<std::size_t> starts_;
+    mutable bool enumerated_ = false;
 };
 
-} // namespace cpp_hub
\ No newline at end of file
+} // namespace cpp_hub
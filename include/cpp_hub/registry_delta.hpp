@@ -0,0 +1,60 @@
+// include/cpp_hub/registry_delta.hpp
+#pragma once
+
+#include "cpp_hub/registry.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace cpp_hub {
+
+// Where a template is cloned from, as far as its cached clone is concerned.
+struct TemplateSource {
+    std::string id;
+    std::string url;
+    std::string revision;
+};
+
+// The sources of every template in registry, in id order.
+std::vector<TemplateSource> template_sources(const Registry& registry);
+
+// Combine the sources of several registries, given in precedence order, as
+// RegistrySet does: an id resolves to the earliest registry that has it.
+std::vector<TemplateSource> merge_template_sources(
+    const std::vector<std::vector<TemplateSource>>& registries);
+
+// How the templates of a registry changed between two versions of its index.
+struct RegistryDelta {
+    std::vector<TemplateSource> added;
+    std::vector<std::string> removed;
+    std::vector<TemplateSource> relocated; // url changed
+    std::vector<TemplateSource> revised;   // same url, revision changed
+
+    bool empty() const {
+        return added.empty() && removed.empty() && relocated.empty() && revised.empty();
+    }
+};
+
+// Compare two id-ordered source lists.
+RegistryDelta diff_template_sources(const std::vector<TemplateSource>& before,
+                                    const std::vector<TemplateSource>& after);
+
+// What refresh_template_cache did to the clones under the cache root.
+struct CacheRefresh {
+    std::vector<std::string> recloned; // from a new url, or a stale clone of an added id
+    std::vector<std::string> pulled;   // for a new revision
+    std::vector<std::string> evicted;  // template no longer in the registry
+    std::vector<std::string> failed;   // left as they were
+};
+
+// Bring the cached clones affected by delta up to date, several at a time:
+// clones of removed templates are deleted, those of relocated ones (and any
+// left over for an id that was just added) are cloned afresh and swapped
+// in, and revised ones are pulled. Compiled forms of replaced clones are
+// dropped. Templates that were never cached are left alone.
+CacheRefresh refresh_template_cache(const RegistryDelta& delta,
+                                    const std::filesystem::path& cacheRoot,
+                                    const std::filesystem::path& compiledRoot);
+
+} // namespace cpp_hub
@@ -0,0 +1,86 @@
+// include/cpp_hub/registry_set.hpp
+#pragma once
+
+#include "cpp_hub/registry.hpp"
+#include "cpp_hub/registry_delta.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// One registry listed in ~/.cpp-hub/registries.json.
+struct RegistrySource {
+    std::string name;
+    std::string url;
+    std::filesystem::path path; // local clone
+};
+
+// The registries to use, in precedence order: those listed in
+// registries.json, each cloned under ~/.cpp-hub/registries/<name>, or just
+// the default registry if there is no such file. Throws std::runtime_error
+// if the file is invalid.
+std::vector<RegistrySource> load_registry_sources();
+
+// Several registries federated into one: templates are merged by id, and
+// an id found in more than one registry resolves to the earliest-listed
+// registry. Registries are cloned, loaded and updated concurrently. The
+// merged view is built the first time it is needed, so looking a template
+// up by id does not enumerate sharded registries.
+class RegistrySet {
+public:
+    RegistrySet(); // from load_registry_sources()
+    explicit RegistrySet(std::vector<RegistrySource> sources);
+
+    // Clone missing registries and load all of them. A registry that fails
+    // is reported and left out; throws only if none could be loaded.
+    void ensure_initialized();
+
+    // Pull every registry (cloning missing ones), then reload. Registries
+    // that fail are reported and left out; returns their names. delta is
+    // set to how the merged view changed; a registry that failed counts as
+    // unchanged.
+    std::vector<std::string> update(RegistryDelta& delta);
+
+    // The loaded registries, in precedence order.
+    std::size_t registry_count() const { return loaded_.size(); }
+    const RegistrySource& source(std::size_t r) const { return sources_[loaded_[r]]; }
+    const Registry& registry(std::size_t r) const { return *registries_[loaded_[r]]; }
+
+    // The merged view, in id order.
+    std::size_t size() const;
+    TemplateView at(std::size_t i) const;
+    std::optional<TemplateView> find_template(std::string_view id) const;
+    // As Registry::search and Registry::with_tags, over the merged view.
+    // Scores are computed within each registry.
+    std::vector<SearchHit> search(std::string_view query, std::size_t limit = 0) const;
+    std::vector<std::size_t> with_tags(const TagQuery& query) const;
+
+private:
+    struct MergedEntry {
+        std::uint32_t registry; // index into loaded_
+        std::uint32_t ordinal;
+    };
+
+    static constexpr std::uint32_t kShadowed = UINT32_MAX;
+
+    void load_all(bool pull, std::vector<std::string>& failed);
+    void ensure_merged() const;
+    std::size_t merged_index(std::size_t r, std::size_t ordinal) const;
+
+    std::vector<RegistrySource> sources_;
+    std::vector<std::unique_ptr<Registry>> registries_; // parallel to sources_
+    std::vector<std::size_t> loaded_;                   // indices into sources_
+
+    // Only built with more than one registry; one registry is its own view.
+    mutable std::vector<MergedEntry> merged_;
+    mutable std::vector<std::vector<std::uint32_t>> mergedIndex_; // per registry and ordinal
+    mutable bool mergedReady_ = false;
+};
+
+} // namespace cpp_hub
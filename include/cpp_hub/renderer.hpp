@@ -1,21 +1,113 @@
 // include/cpp_hub/renderer.hpp
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace cpp_hub {
 
+class CompiledTemplate;
+class IgnoreMatcher;
+class OutputBackend;
+struct GenerationRecord;
+struct RegenSummary;
+
+// Measurements of the file-rendering phase of a render.
+struct RenderStats {
+    std::size_t files = 0;
+    // Heap allocations made while files were rendered and written; only
+    // counted in builds with CPP_HUB_COUNT_ALLOCATIONS (see alloc_counter.hpp).
+    std::uint64_t heapAllocations = 0;
+};
+
+struct RenderOptions {
+    // If false, the targetRoot must not exist yet.
+    // If true, files and directories are merged into an existing tree,
+    // overriding files if they already exist.
+    bool allowExisting = false;
+    // Number of threads used to render files; 0 selects the hardware concurrency.
+    unsigned jobs = 0;
+    // Pre-scanned form of the template (see template_cache.hpp). When
+    // templateRoot is its root or a directory inside it, the file list and
+    // token positions come from it instead of walking and scanning the tree.
+    const CompiledTemplate* compiled = nullptr;
+    // Template paths not to generate (see ignore_matcher.hpp), relative to
+    // the first layer. Compiled templates already leave them out.
+    const IgnoreMatcher* ignore = nullptr;
+    // Files larger than this are streamed through a fixed-size buffer instead
+    // of being rendered in memory, so memory use does not grow with file size.
+    std::uint64_t streamingThreshold = 32ull << 20;
+    // Files at least this large are cut at token-safe boundaries and the
+    // pieces substituted on several threads (when more than one job is used).
+    std::uint64_t parallelThreshold = 16ull << 20;
+    // Batch directory creation and file writes through io_uring when the
+    // kernel supports it; otherwise (or if false) plain POSIX calls are used.
+    bool useIoUring = true;
+    // Write through this backend instead of a built-in one. targetRoot is
+    // then neither checked nor created on disk (e.g. for ArchiveOutput).
+    OutputBackend* output = nullptr;
+    // If set, the hash of every generated file is added to it and the record
+    // is saved into targetRoot (see generation_record.hpp).
+    GenerationRecord* record = nullptr;
+    // With `record`: the record targetRoot was generated with. Outputs whose
+    // content is unchanged are not rewritten, files edited since are left
+    // alone and outputs no longer produced are removed; see `summary`.
+    const GenerationRecord* previousRecord = nullptr;
+    RegenSummary* summary = nullptr;
+    // If set, filled in once the render has succeeded.
+    RenderStats* stats = nullptr;
+};
+
 // Copy directory tree from templateRoot to targetRoot, applying {{var}} replacements.
 //
-// If allowExisting is false (default), the targetRoot must not exist yet.
-// If allowExisting is true, files and directories are merged into an existing tree,
-// overriding files if they already exist.
+// The tree is enumerated once and every directory is created up front; files
+// are then rendered in parallel. If several files fail, the error reported is
+// the one for the file that comes first in enumeration order.
 bool render_template(
     const std::filesystem::path& templateRoot,
     const std::filesystem::path& targetRoot,
     const std::unordered_map<std::string, std::string>& values,
-    bool allowExisting = false);
+    const RenderOptions& options = {});
+
+// Render several source trees into targetRoot as if each were rendered on top
+// of the previous one, later layers overriding files of earlier ones. The
+// merged tree is resolved first, so every destination file is written once.
+// Directories listed in `pruned` are never walked, in any layer.
+bool render_layers(
+    const std::vector<std::filesystem::path>& layers,
+    const std::vector<std::filesystem::path>& pruned,
+    const std::filesystem::path& targetRoot,
+    const std::unordered_map<std::string, std::string>& values,
+    const RenderOptions& options = {});
+
+// One file of a RenderPlan.
+struct PlannedFile {
+    std::string destRel;           // destination relative to the target root
+    std::uint64_t bytes = 0;       // size of the template file
+    std::uint64_t outputBytes = 0; // size once rendered
+    std::size_t tokens = 0;        // variables substituted in its contents
+    bool verbatim = false;         // copied as-is (binary, or nothing to substitute)
+};
+
+// What render_layers would do, without doing it.
+struct RenderPlan {
+    std::vector<PlannedFile> files; // in rendering order
+    std::size_t directories = 0;
+    double collectSeconds = 0; // resolving layers and substituting paths
+    double scanSeconds = 0;    // reading and scanning file contents
+};
+
+// Resolve and scan the same tree render_layers would, writing nothing.
+// Only options.jobs, options.compiled and options.ignore are used.
+bool plan_layers(
+    const std::vector<std::filesystem::path>& layers,
+    const std::vector<std::filesystem::path>& pruned,
+    const std::unordered_map<std::string, std::string>& values,
+    const RenderOptions& options,
+    RenderPlan& plan);
 
-} // namespace cpp_hub
\ No newline at end of file
+} // namespace cpp_hub
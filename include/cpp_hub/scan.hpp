@@ -0,0 +1,27 @@
+// include/cpp_hub/scan.hpp
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace cpp_hub {
+
+struct ScanResult {
+    // Offset of the first "{{" in the buffer, or std::string_view::npos.
+    std::size_t firstToken;
+    // True if the buffer contains a NUL byte. Such files are treated as
+    // binary and copied verbatim; the scan stops at the first NUL.
+    bool binary;
+};
+
+// Classify a buffer in one pass: locate the first "{{" and detect NUL bytes.
+// Uses AVX2 or SSE2 when the CPU supports it, chosen once at runtime.
+ScanResult scan_buffer(std::string_view data);
+
+// Offset of the next "{{" at or after from, or std::string_view::npos.
+std::size_t find_token_open(std::string_view text, std::size_t from);
+
+// Name of the kernel selected for this CPU ("avx2", "sse2" or "scalar").
+const char* scan_kernel_name();
+
+} // namespace cpp_hub
@@ -0,0 +1,73 @@
+// include/cpp_hub/search_index.hpp
+#pragma once
+
+#include "cpp_hub/util/binary_io.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_hub {
+
+// The searchable fields of a template.
+enum class SearchField : std::uint8_t { Id, Name, Description, Tag };
+inline constexpr std::size_t kSearchFieldCount = 4;
+
+// Lowercase ASCII letters in place; search is case-insensitive in the same
+// way as util::icontains.
+void fold_case(std::string& s);
+
+// Substring index over the searchable text of the registry's templates:
+// for every trigram (three consecutive bytes of a lowercased field) the
+// ascending ordinals of the templates containing it. A template can only
+// contain a query if it contains all of the query's trigrams, so a search
+// intersects their posting lists and verifies just those candidates.
+class TrigramIndex {
+public:
+    // Collects the trigrams of templates added in ordinal order.
+    class Builder {
+    public:
+        // Add a field of the next template; text must already be lowercased.
+        // Tags are added one call per tag.
+        void add_text(SearchField field, std::string_view text);
+        // Close the current template, which gets the next ordinal.
+        void end_template();
+        // Append the index in the layout read by TrigramIndex::decode.
+        void write(util::BinaryWriter& w) const;
+
+    private:
+        std::vector<std::uint32_t> current_;
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings_;
+        std::uint32_t next_ = 0;
+        double lengths_[kSearchFieldCount] = {}; // bytes, or number of tags
+    };
+
+    // Read an index written by Builder::write; the data must outlive *this.
+    // Throws std::runtime_error if it is malformed.
+    void decode(util::BinaryReader& r);
+
+    // Store in `out` the ascending ordinals of templates that may contain
+    // the lowercased query. Returns false (leaving `out` alone) if the query
+    // is too short to have a trigram, in which case every template may.
+    // Ordinals are only as valid as the data: callers must bounds-check them.
+    bool candidates(std::string_view query, std::vector<std::uint32_t>& out) const;
+
+    // Average length of a field over all templates: in bytes, or for tags
+    // the number of tags. Used to normalize relevance scores.
+    double average_length(SearchField field) const {
+        return averages_[static_cast<std::size_t>(field)];
+    }
+
+private:
+    std::span<const std::uint32_t> postings_for(std::uint32_t trigram) const;
+
+    std::span<const std::uint32_t> trigrams_; // sorted
+    std::span<const std::uint32_t> starts_;   // trigrams_.size() + 1 offsets into postings_
+    std::span<const std::uint32_t> postings_;
+    double averages_[kSearchFieldCount] = {};
+};
+
+} // namespace cpp_hub
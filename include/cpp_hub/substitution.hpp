@@ -0,0 +1,82 @@
+// include/cpp_hub/substitution.hpp
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_hub {
+
+// Lookup table for {{key}} tokens. Built once per render so that scanning a
+// buffer never has to allocate to look up a variable name.
+class SubstitutionTable {
+public:
+    explicit SubstitutionTable(const std::unordered_map<std::string, std::string>& values);
+
+    // Returns the replacement for key, or nullptr if key is not a variable.
+    const std::string* find(std::string_view key) const;
+
+    bool empty() const { return entries_.empty(); }
+    std::size_t max_key_length() const { return maxKeyLength_; }
+
+private:
+    std::unordered_map<std::string_view, const std::string*> entries_;
+    std::size_t maxKeyLength_;
+};
+
+// A known {{key}} token located in a buffer.
+struct TokenSpan {
+    std::size_t offset;       // position of the opening "{{"
+    std::size_t length;       // length of the whole token, braces included
+    const std::string* value; // replacement text
+};
+
+// Scan text once and append every known token to spans, in order.
+// Returns the size of text after all found tokens are replaced.
+std::size_t find_tokens(
+    std::string_view text,
+    const SubstitutionTable& table,
+    std::vector<TokenSpan>& spans);
+
+// Append text to out with the given spans (as returned by find_tokens) replaced.
+void splice_tokens(
+    std::string_view text,
+    const std::vector<TokenSpan>& spans,
+    std::string& out);
+
+// Replace every known {{key}} in text. Unknown tokens are left untouched.
+std::string apply_substitutions(std::string_view text, const SubstitutionTable& table);
+
+// Cut text into pieces of roughly `target` bytes such that no token, matched
+// or not, straddles a cut: substituting every piece on its own and joining the
+// results gives exactly apply_substitutions(text). Returns the cut offsets,
+// starting with 0 and ending with text.size().
+std::vector<std::size_t> split_at_safe_boundaries(
+    std::string_view text,
+    const SubstitutionTable& table,
+    std::size_t target);
+
+// Substitution over input that arrives in chunks, producing exactly what
+// apply_substitutions would for the concatenated input. A token split across
+// chunks is completed by holding back the last few bytes of each chunk, so
+// memory use is bounded by the chunk size rather than the input size.
+class StreamingSubstitution {
+public:
+    explicit StreamingSubstitution(const SubstitutionTable& table);
+
+    // Append the output that the next chunk settles to out.
+    void feed(std::string_view chunk, std::string& out);
+    // Signal the end of input and append whatever was held back to out.
+    void finish(std::string& out);
+
+private:
+    void drain(bool last, std::string& out);
+
+    const SubstitutionTable& table_;
+    std::string pending_;
+    std::vector<TokenSpan> spans_;
+};
+
+} // namespace cpp_hub
@@ -0,0 +1,83 @@
+// include/cpp_hub/tag_index.hpp
+#pragma once
+
+#include "cpp_hub/util/binary_io.hpp"
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// One roaring-style container: the ordinals whose upper 16 bits are `key`,
+// stored as a sorted array of their lower 16 bits, or as a 2^16-bit bitmap
+// once there are too many for the array to be smaller.
+struct PackedContainer {
+    std::uint16_t key;
+    std::uint16_t dense;       // 1 if the container is a bitmap
+    std::uint32_t cardinality;
+    std::uint32_t offset;      // into the index's arrays (values) or bitmaps (words)
+};
+
+// Set of template ordinals below a fixed bound, as a plain bitset: tag
+// queries combine their operands in this form.
+class TemplateSet {
+public:
+    explicit TemplateSet(std::size_t size, bool full = false);
+
+    void intersect(const TemplateSet& other);
+    void unite(const TemplateSet& other);
+    void subtract(const TemplateSet& other);
+
+    // Ascending ordinals of the members.
+    std::vector<std::size_t> members() const;
+
+private:
+    friend class TagIndex;
+
+    std::size_t size_;
+    std::vector<std::uint64_t> words_;
+};
+
+// For every distinct tag, case-folded, the templates carrying it, as a
+// compressed bitmap of ordinals.
+class TagIndex {
+public:
+    class Builder {
+    public:
+        // Record that template `ordinal` has `tag`; ordinals must not decrease.
+        void add(std::string_view tag, std::uint32_t ordinal);
+        // Append the index in the layout read by TagIndex::decode.
+        void write(util::BinaryWriter& w) const;
+
+    private:
+        std::map<std::string, std::vector<std::uint32_t>, std::less<>> tags_;
+    };
+
+    // Read an index written by Builder::write; the data must outlive *this.
+    // Throws std::runtime_error if it is malformed.
+    void decode(util::BinaryReader& r);
+
+    // The templates with `tag`, compared case-insensitively; ordinals at or
+    // beyond `size` are dropped.
+    TemplateSet lookup(std::string_view tag, std::size_t size) const;
+
+private:
+    struct PackedTag {
+        std::uint32_t nameOffset;
+        std::uint32_t nameLength;
+        std::uint32_t firstContainer;
+        std::uint32_t containerCount;
+    };
+
+    std::span<const PackedTag> tags_; // sorted by name
+    std::span<const PackedContainer> containers_;
+    std::span<const std::uint16_t> values_;
+    std::span<const std::uint64_t> words_;
+    std::string_view names_;
+};
+
+} // namespace cpp_hub
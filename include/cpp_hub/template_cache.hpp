@@ -0,0 +1,100 @@
+// include/cpp_hub/template_cache.hpp
+#pragma once
+
+#include "cpp_hub/template_manifest.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+// A {{key}} token recorded when a template was compiled.
+struct PackedToken {
+    std::uint64_t offset;
+    std::uint32_t length;
+    std::uint32_t key; // index into CompiledTemplate::keys()
+};
+
+struct CompiledEntry {
+    std::string_view relPath; // relative to the template root, not substituted
+    bool directory;
+    bool verbatim;            // binary or token-free; copied as is
+    std::filesystem::perms perms;
+    std::uint64_t size;       // file size when compiled
+    // and modification time (util::MappedFile::modified; for directories,
+    // as told by std::filesystem::last_write_time)
+    std::int64_t modified;
+    std::uint64_t digest;     // content_digest of a verbatim file, else 0
+    std::span<const PackedToken> pathTokens;
+    std::span<const PackedToken> contentTokens;
+
+    // True if file, as opened now, is still the file that was compiled.
+    // Nothing stops the checkout from being edited without a new commit,
+    // and stale token offsets would corrupt the output.
+    bool matches(const util::MappedFile& file) const {
+        return file.size() == size && file.modified() == modified &&
+               file.permissions() == perms;
+    }
+};
+
+// Pre-scanned form of a cached template checkout: the parsed manifest, the
+// file list, and the position of every variable token in paths and file
+// contents. It is stored as one file and mapped read-only on later runs, so
+// repeat generations skip manifest parsing, the directory walk and scanning.
+class CompiledTemplate {
+public:
+    // Return the compiled form of templateRoot, (re)building cacheFile when it
+    // is missing, unreadable, or was built for a different git HEAD, or when
+    // the manifest, .hubignore or a directory changed since (edits made
+    // without a commit).
+    // Returns nullptr if templateRoot is not a git checkout; the caller then
+    // renders straight from the tree. Throws if the manifest is invalid.
+    // Entries must be checked with CompiledEntry::matches before use.
+    static std::unique_ptr<CompiledTemplate> load_or_build(
+        const std::filesystem::path& templateRoot,
+        const std::filesystem::path& cacheFile);
+
+    const std::filesystem::path& root() const { return root_; }
+    const std::string& head() const { return head_; }
+    const TemplateManifest& manifest() const { return manifest_; }
+    const std::vector<std::string_view>& keys() const { return keys_; }
+    const std::vector<CompiledEntry>& entries() const { return entries_; }
+
+private:
+    // Enough of a file's or directory's metadata to notice that it changed.
+    struct Stamp {
+        std::int64_t size = -1; // -1 if missing; 0 for directories
+        std::int64_t modified = 0;
+        bool operator==(const Stamp&) const = default;
+    };
+
+    CompiledTemplate() = default;
+
+    static Stamp stamp_of(const std::filesystem::path& path);
+    // Paths whose stamps are kept besides the entries.
+    static std::vector<std::filesystem::path> stamped_paths(const std::filesystem::path& root);
+    // True if nothing stamped has changed since compiling.
+    bool unchanged() const;
+
+    static std::string compile(const std::filesystem::path& root, const std::string& head);
+    // Decode data (which must outlive *this); throws on malformed input.
+    void decode(std::string_view data);
+
+    std::filesystem::path root_;
+    std::string head_;
+    TemplateManifest manifest_;
+    std::vector<std::string_view> keys_;
+    std::vector<CompiledEntry> entries_;
+    std::vector<Stamp> stamps_; // of stamped_paths(root_)
+
+    util::MappedFile file_; // backing storage when loaded from disk
+    std::string owned_;     // backing storage when freshly compiled
+};
+
+} // namespace cpp_hub
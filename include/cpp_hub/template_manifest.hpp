@@ -45,6 +45,10 @@ struct TemplateManifest {
 
     // NEW: optional overlays
     std::vector<OverlayRule> overlays;
+
+    // gitignore-style patterns of template paths not to generate (see
+    // ignore_matcher.hpp); a .hubignore file adds to them.
+    std::vector<std::string> ignore;
 };
 
 TemplateManifest load_manifest(const std::filesystem::path& manifestPath);
@@ -56,4 +60,9 @@ bool collect_variables_interactively(
     bool useDefaults,
     std::unordered_map<std::string, std::string>& outValues);
 
+// Check a value given for vd non-interactively (e.g. on the command line),
+// normalizing booleans to "true"/"false". Prints why and returns false if
+// the value is not acceptable.
+bool validate_variable_value(const VariableDef& vd, std::string& value);
+
 } // namespace cpp_hub
\ No newline at end of file
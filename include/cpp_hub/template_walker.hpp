@@ -0,0 +1,36 @@
+// include/cpp_hub/template_walker.hpp
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_hub {
+
+class IgnoreMatcher;
+
+struct WalkEntry {
+    std::filesystem::path source; // absolute path inside the template
+    std::string relPath;          // generic path relative to the walked root
+    bool directory;
+};
+
+// Enumerate the directories and regular files under root, parents before
+// their children, skipping `.git`, `hub-manifest.json` and, at the template
+// root only, `.hubignore`.
+// Entries whose relative path is listed in `pruned`, or that `ignore`
+// matches, are skipped without being descended into. Ignore patterns are
+// matched against ignorePrefix + "/" + the relative path, ignorePrefix
+// being where root lies in the template (empty for the template root).
+// Symlinks are listed under their own name as what they point to, but never
+// descended into.
+// Errors are printed to stderr and make the walk return false.
+bool walk_template(
+    const std::filesystem::path& root,
+    std::vector<WalkEntry>& entries,
+    const std::vector<std::string>& pruned = {},
+    const IgnoreMatcher* ignore = nullptr,
+    std::string_view ignorePrefix = {});
+
+} // namespace cpp_hub
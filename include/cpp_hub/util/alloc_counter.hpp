@@ -0,0 +1,16 @@
+// include/cpp_hub/util/alloc_counter.hpp
+#pragma once
+
+#include <cstdint>
+
+namespace cpp_hub::util {
+
+// True if this build counts heap allocations (CMake option
+// CPP_HUB_COUNT_ALLOCATIONS, which replaces the global operator new).
+bool counting_heap_allocations();
+
+// Heap allocations made by the whole process so far, or 0 if they are not
+// counted. Take the difference of two readings to measure a phase.
+std::uint64_t heap_allocations();
+
+} // namespace cpp_hub::util
@@ -0,0 +1,99 @@
+// include/cpp_hub/util/binary_io.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cpp_hub::util {
+
+// Helpers for the on-disk caches under ~/.cpp-hub. Values are stored in host
+// byte order: the files are local caches, never shared between machines.
+
+class BinaryWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put_string(std::string_view s) {
+        put(static_cast<std::uint32_t>(s.size()));
+        buffer_.append(s.data(), s.size());
+    }
+
+    void put_bytes(const void* data, std::size_t size) {
+        buffer_.append(static_cast<const char*>(data), size);
+    }
+
+    // Pad with zero bytes so the next value starts at a multiple of alignment.
+    void align(std::size_t alignment) {
+        buffer_.append((alignment - buffer_.size() % alignment) % alignment, '\0');
+    }
+
+    std::size_t size() const { return buffer_.size(); }
+    const std::string& data() const { return buffer_; }
+    // Move the buffer out, leaving the writer empty.
+    std::string take() { return std::move(buffer_); }
+
+private:
+    std::string buffer_;
+};
+
+// Bounds-checked reader over a buffer written by BinaryWriter. Throws
+// std::runtime_error if the buffer is truncated.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string_view get_string() {
+        const auto size = get<std::uint32_t>();
+        return {take(size), size};
+    }
+
+    // Pointer to `count` values of T stored in place. The caller must have
+    // aligned the writer for T; the buffer itself must be suitably aligned.
+    template <typename T>
+    const T* get_array(std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (count > (data_.size() - pos_) / sizeof(T)) {
+            throw std::runtime_error("truncated cache file");
+        }
+        return reinterpret_cast<const T*>(take(count * sizeof(T)));
+    }
+
+    void align(std::size_t alignment) {
+        take((alignment - pos_ % alignment) % alignment);
+    }
+
+    bool at_end() const { return pos_ == data_.size(); }
+
+private:
+    const char* take(std::size_t size) {
+        if (size > data_.size() - pos_) {
+            throw std::runtime_error("truncated cache file");
+        }
+        const char* p = data_.data() + pos_;
+        pos_ += size;
+        return p;
+    }
+
+    std::string_view data_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace cpp_hub::util
@@ -2,10 +2,61 @@
 #pragma once
 
 #include <filesystem>
+#include <string_view>
+#include <system_error>
 
 namespace cpp_hub::util {
 
 std::filesystem::path get_home_directory();
 bool ensure_directory(const std::filesystem::path& dir);
 
-} // namespace cpp_hub::util
\ No newline at end of file
+// Create or truncate dest and write data to it with the given permission bits.
+bool write_file(
+    const std::filesystem::path& dest,
+    std::string_view data,
+    std::filesystem::perms perms,
+    std::error_code& ec);
+
+// Write data to dest via a temporary file and a rename, so concurrent
+// readers never observe a half-written file. Used for the caches under
+// ~/.cpp-hub; the parent directory is created if needed.
+bool write_file_atomically(
+    const std::filesystem::path& dest,
+    std::string_view data,
+    std::error_code& ec);
+
+// Output file written piece by piece, for content too large to build in
+// memory first. The file is created or truncated with the given permission bits.
+class OutputFile {
+public:
+    OutputFile() = default;
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    bool open(const std::filesystem::path& dest, std::filesystem::perms perms,
+              std::error_code& ec);
+    bool write(std::string_view data, std::error_code& ec);
+    bool close(std::error_code& ec);
+
+private:
+#ifdef _WIN32
+    std::filesystem::path path_;
+    std::filesystem::perms perms_ = std::filesystem::perms::none;
+    void* stream_ = nullptr; // std::ofstream*
+#else
+    int fd_ = -1;
+#endif
+};
+
+// Copy src to dest (created or truncated) without passing the bytes through
+// user space where the platform allows it. On Linux this tries a reflink
+// (FICLONE) first, then copy_file_range, then sendfile. The permission bits
+// of src are preserved.
+bool copy_file_fast(
+    const std::filesystem::path& src,
+    const std::filesystem::path& dest,
+    std::error_code& ec);
+
+} // namespace cpp_hub::util
@@ -0,0 +1,19 @@
+// include/cpp_hub/util/git.hpp
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace cpp_hub::util {
+
+// Commit id checked out in the repository at repo, read straight from the
+// .git directory (loose or packed refs) without spawning git.
+// Returns an empty string if it cannot be determined.
+std::string head_commit(const std::filesystem::path& repo);
+
+// Committer time of HEAD in seconds since the epoch, asked of git.
+// Returns -1 if it cannot be determined.
+std::int64_t head_commit_time(const std::filesystem::path& repo);
+
+} // namespace cpp_hub::util
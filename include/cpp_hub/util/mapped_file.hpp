@@ -0,0 +1,47 @@
+// include/cpp_hub/util/mapped_file.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace cpp_hub::util {
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'ed;
+// elsewhere its contents are read into memory.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::filesystem::path& path, std::error_code& ec);
+    void close();
+
+    bool is_open() const { return open_; }
+    std::string_view view() const { return {data_, size_}; }
+    std::size_t size() const { return size_; }
+    // Permission bits of the file when it was opened.
+    std::filesystem::perms permissions() const { return perms_; }
+    // Modification time of the file when it was opened, in nanoseconds. Only
+    // meaningful compared with other values from this function.
+    std::int64_t modified() const { return modified_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::filesystem::perms perms_ = std::filesystem::perms::none;
+    std::int64_t modified_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;
+    std::string buffer_; // used when the file is read rather than mapped
+};
+
+} // namespace cpp_hub::util
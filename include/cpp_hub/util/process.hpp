@@ -8,5 +8,8 @@ namespace cpp_hub::util {
 
 bool run_command(const std::string& cmd);
 bool run_command_in_dir(const std::string& cmd, const std::filesystem::path& dir);
+// Run cmd without echoing it and collect its standard output. Returns false
+// if it cannot be run or exits with a non-zero status.
+bool capture_command(const std::string& cmd, std::string& output);
 
 } // namespace cpp_hub::util
\ No newline at end of file
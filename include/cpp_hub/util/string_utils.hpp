@@ -2,13 +2,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace cpp_hub::util {
 
 std::string to_lower(std::string s);
 std::string trim(const std::string& s);
-bool iequals(const std::string& a, const std::string& b);
-bool icontains(const std::string& text, const std::string& sub);
+bool iequals(std::string_view a, std::string_view b);
+bool icontains(std::string_view text, std::string_view sub);
 bool parse_bool(const std::string& text, bool& out);
 
 } // namespace cpp_hub::util
\ No newline at end of file
@@ -0,0 +1,25 @@
+// include/cpp_hub/util/thread_pool.hpp
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace cpp_hub::util {
+
+// Number of worker threads to use when the user did not ask for a specific
+// count: the hardware concurrency, or 1 if it is unknown.
+unsigned default_jobs();
+
+// Run task(i) for every i in [0, count) on up to `jobs` threads (0 selects
+// default_jobs()). The calling thread takes part in the work.
+//
+// Each worker starts with a contiguous block of indices and processes it in
+// ascending order; a worker that runs dry steals from the back of the
+// others' blocks. If a task throws, the first exception is rethrown once all
+// workers have stopped.
+void parallel_for(
+    std::size_t count,
+    unsigned jobs,
+    const std::function<void(std::size_t)>& task);
+
+} // namespace cpp_hub::util
@@ -1,17 +1,36 @@
 // src/cli/cli.cpp
 #include "cpp_hub/cli.hpp"
 
+#include "cpp_hub/archive_output.hpp"
 #include "cpp_hub/config.hpp"
+#include "cpp_hub/generation_record.hpp"
+#include "cpp_hub/ignore_matcher.hpp"
+#include "cpp_hub/object_store.hpp"
 #include "cpp_hub/registry.hpp"
+#include "cpp_hub/registry_delta.hpp"
+#include "cpp_hub/registry_set.hpp"
 #include "cpp_hub/renderer.hpp"
+#include "cpp_hub/scan.hpp"
+#include "cpp_hub/template_cache.hpp"
 #include "cpp_hub/template_manifest.hpp"
+#include "cpp_hub/util/alloc_counter.hpp"
 #include "cpp_hub/util/fs.hpp"
+#include "cpp_hub/util/git.hpp"
 #include "cpp_hub/util/process.hpp"
 #include "cpp_hub/util/string_utils.hpp"
+#include "cpp_hub/util/thread_pool.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -19,13 +38,26 @@
 #include <functional>
 
 namespace fs = std::filesystem;
-using cpp_hub::util::icontains;
-using cpp_hub::util::iequals;
 using cpp_hub::util::parse_bool;
 using cpp_hub::util::trim;
 
 namespace cpp_hub::cli {
 
+// Options accepted by both `new <template-id>` and `new --git <url>`.
+struct GenerationOptions {
+    bool useDefaults = false;
+    bool plan = false; // only report what would be generated
+    unsigned jobs = 0; // 0 = hardware concurrency
+    std::string archive; // write a tar archive here ("-" = stdout) instead of a directory
+    bool zstd = false;   // compress the archive
+};
+
+enum class OptionParse {
+    Unknown,  // not a generation option
+    Consumed, // parsed (together with its value, if any)
+    Invalid   // recognized but malformed; an error was printed
+};
+
 static int handle_version(const std::vector<std::string>& args);
 static int handle_update(const std::vector<std::string>& args);
 static int handle_search(const std::vector<std::string>& args);
@@ -34,14 +66,46 @@ static int handle_validate(const std::vector<std::string>& args);
 static int handle_new(const std::vector<std::string>& args);
 static int handle_new_from_registry(const std::vector<std::string>& args);
 static int handle_new_from_git(const std::vector<std::string>& args);
-static int run_generation(const fs::path& templateRepoPath, bool useDefaults);
+static int handle_regen(const std::vector<std::string>& args);
+static OptionParse parse_generation_option(
+    const std::vector<std::string>& args, size_t& i, GenerationOptions& opts);
+static bool check_generation_options(GenerationOptions& opts);
+static bool load_template(const fs::path& templateRepoPath,
+                          std::unique_ptr<CompiledTemplate>& compiled,
+                          TemplateManifest& manifest,
+                          IgnoreMatcher& ignore);
+static void select_layers(const fs::path& templateRepoPath,
+                          const TemplateManifest& manifest,
+                          const std::unordered_map<std::string, std::string>& values,
+                          std::vector<fs::path>& layers,
+                          std::vector<fs::path>& overlaySources,
+                          std::vector<std::string>& activeOverlays);
+static int run_generation(const fs::path& templateRepoPath, const GenerationOptions& opts);
+static int run_plan(const fs::path& templateRepoPath,
+                    const TemplateManifest& manifest,
+                    const CompiledTemplate* compiled,
+                    const IgnoreMatcher& ignore,
+                    const std::unordered_map<std::string, std::string>& values,
+                    const GenerationOptions& opts,
+                    double manifestSeconds,
+                    double variableSeconds);
+static int run_archive(const fs::path& templateRepoPath,
+                       const TemplateManifest& manifest,
+                       const CompiledTemplate* compiled,
+                       const IgnoreMatcher& ignore,
+                       const std::unordered_map<std::string, std::string>& values,
+                       const GenerationOptions& opts,
+                       const std::string& rootName);
 
 void print_usage(std::ostream& os) {
     os << "Usage:\n"
-       << "  cpp-hub new <template-id> [--defaults]\n"
-       << "  cpp-hub new --git <url> [--branch <name>] [--defaults]\n"
-       << "  cpp-hub search <query>\n"
-       << "  cpp-hub list [--tag <tag>]\n"
+       << "  cpp-hub new <template-id> [--defaults] [--jobs <n>] [--plan]\n"
+       << "                            [--output-archive <file|->] [--zstd]\n"
+       << "  cpp-hub new --git <url> [--branch <name>] [--defaults] [--jobs <n>] [--plan]\n"
+       << "                          [--output-archive <file|->] [--zstd]\n"
+       << "  cpp-hub regen [<project-dir>] [--set <name>=<value>]... [--defaults] [--jobs <n>]\n"
+       << "  cpp-hub search <query> [--limit <k>]\n"
+       << "  cpp-hub list [--tag <tag>]... [--any-tag <tag>]... [--not-tag <tag>]...\n"
        << "  cpp-hub update\n"
        << "  cpp-hub validate <path>\n"
        << "  cpp-hub version\n";
@@ -77,6 +141,8 @@ int run(int argc, char** argv) {
         return handle_validate(rest);
     } else if (cmd == "new") {
         return handle_new(rest);
+    } else if (cmd == "regen") {
+        return handle_regen(rest);
     } else {
         std::cerr << "Unknown command: " << cmd << "\n";
         print_usage(std::cerr);
@@ -86,36 +152,117 @@ int run(int argc, char** argv) {
 
 static int handle_version(const std::vector<std::string>& /*args*/) {
     std::cout << "cpp-hub version " << cpp_hub::version() << "\n";
-    fs::path regPath = cpp_hub::registry_path();
-    std::cout << "Registry path: " << regPath << " (";
-    if (fs::exists(regPath)) {
-        std::cout << "exists";
-    } else {
-        std::cout << "not initialized";
+
+    std::vector<cpp_hub::RegistrySource> sources;
+    try {
+        sources = cpp_hub::load_registry_sources();
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid registry list: " << e.what() << "\n";
+        return 1;
     }
-    std::cout << ")\n";
 
-    if (fs::exists(regPath)) {
-        try {
-            cpp_hub::Registry reg;
-            reg.reload();
-            if (!reg.name().empty()) {
-                std::cout << "Registry name: " << reg.name() << "\n";
+    for (const auto& source : sources) {
+        const fs::path& regPath = source.path;
+        if (sources.size() > 1) {
+            std::cout << "Registry '" << source.name << "': " << source.url << "\n  ";
+        }
+        std::cout << "Registry path: " << regPath << " (";
+        if (fs::exists(regPath)) {
+            std::cout << "exists";
+        } else {
+            std::cout << "not initialized";
+        }
+        std::cout << ")\n";
+
+        if (fs::exists(regPath)) {
+            try {
+                cpp_hub::Registry reg(source.path, source.url);
+                reg.reload();
+                if (!reg.name().empty()) {
+                    std::cout << (sources.size() > 1 ? "  " : "")
+                              << "Registry name: " << reg.name() << "\n";
+                }
+            } catch (...) {
+                // Best-effort; ignore errors here.
             }
-        } catch (...) {
-            // Best-effort; ignore errors here.
         }
     }
 
     return 0;
 }
 
+// Turn a freshly cloned or updated template checkout into links into the
+// object store, so files it shares with other cached templates are stored
+// once.
+static void store_template_files(const fs::path& tplPath, unsigned jobs) {
+    const cpp_hub::ObjectStore store(cpp_hub::objects_root());
+    const cpp_hub::ObjectStore::AbsorbStats stats = store.absorb(tplPath, jobs);
+    if (stats.shared > 0) {
+        std::cout << "Shared " << stats.shared << " of " << stats.files
+                  << " template files with other cached templates (" << stats.savedBytes
+                  << " bytes saved).\n";
+    }
+}
+
+// One line per kind of cache refresh, e.g. "Re-cloned cached templates: a, b".
+static void print_cache_action(std::ostream& os, const char* what,
+                               const std::vector<std::string>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+    os << what << ": ";
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        os << (i == 0 ? "" : ", ") << ids[i];
+    }
+    os << "\n";
+}
+
+static void print_registry_delta(const cpp_hub::RegistryDelta& delta) {
+    if (delta.empty()) {
+        std::cout << "No template changes.\n";
+        return;
+    }
+    std::cout << "Template changes: " << delta.added.size() << " added, "
+              << delta.removed.size() << " removed, "
+              << delta.relocated.size() << " with a new url, "
+              << delta.revised.size() << " with a new revision.\n";
+}
+
 static int handle_update(const std::vector<std::string>& /*args*/) {
     try {
-        cpp_hub::Registry reg;
-        reg.update();
-        std::cout << "Registry updated. Templates: " << reg.templates().size() << "\n";
-        return 0;
+        cpp_hub::RegistrySet regs;
+        cpp_hub::RegistryDelta delta;
+        const std::vector<std::string> failed = regs.update(delta);
+        if (regs.registry_count() == 1 && failed.empty()) {
+            std::cout << "Registry updated. Templates: " << regs.size() << "\n";
+        } else {
+            for (std::size_t r = 0; r < regs.registry_count(); ++r) {
+                std::cout << "Registry '" << regs.source(r).name << "' updated. Templates: "
+                          << regs.registry(r).size() << "\n";
+            }
+            std::cout << "Templates across registries: " << regs.size() << "\n";
+            for (const auto& name : failed) {
+                std::cerr << "Failed to update registry '" << name << "'.\n";
+            }
+        }
+
+        print_registry_delta(delta);
+        const cpp_hub::CacheRefresh refresh = cpp_hub::refresh_template_cache(
+            delta, cpp_hub::cache_root(), cpp_hub::compiled_cache_root());
+        print_cache_action(std::cout, "Re-cloned cached templates", refresh.recloned);
+        print_cache_action(std::cout, "Pulled cached templates", refresh.pulled);
+        print_cache_action(std::cout, "Evicted cached templates", refresh.evicted);
+        print_cache_action(std::cerr, "Failed to refresh cached templates", refresh.failed);
+        for (const auto* ids : {&refresh.recloned, &refresh.pulled}) {
+            for (const auto& id : *ids) {
+                store_template_files(cpp_hub::cache_root() / id, 0);
+            }
+        }
+        if (!refresh.recloned.empty() || !refresh.pulled.empty() || !refresh.evicted.empty()) {
+            cpp_hub::ObjectStore(cpp_hub::objects_root()).prune();
+        }
+
+        return failed.empty() && refresh.failed.empty() ? 0 : 1;
     } catch (const std::exception& e) {
         std::cerr << "Failed to update registry: " << e.what() << "\n";
         return 1;
@@ -132,43 +279,60 @@ static void print_template_table_header() {
     std::cout << std::string(20 + 24 + 14 + 40, '-') << "\n";
 }
 
-static int handle_search(const std::vector<std::string>& args) {
-    if (args.empty()) {
-        std::cerr << "search: missing <query>\n";
-        print_usage(std::cerr);
-        return 1;
+static void print_template_row(const cpp_hub::TemplateView& t) {
+    std::cout << std::left
+              << std::setw(20) << t.id().substr(0, 19)
+              << std::setw(24) << t.name().substr(0, 23)
+              << std::setw(14) << t.build_system().substr(0, 13)
+              << t.description()
+              << "\n";
+}
+
+// Parse a positive decimal count of at most `max`. std::stoul accepts a sign
+// (and wraps "-1" around), so only plain digits are let through to it.
+static bool parse_count(const std::string& value, unsigned long max, unsigned long& count) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    try {
+        count = std::stoul(value);
+    } catch (const std::exception&) {
+        return false;
     }
+    return count != 0 && count <= max;
+}
 
+static int handle_search(const std::vector<std::string>& args) {
     std::string query;
+    std::size_t limit = 0;
     for (size_t i = 0; i < args.size(); ++i) {
-        if (i > 0) query += ' ';
+        if (args[i] == "--limit") {
+            if (i + 1 >= args.size()) {
+                std::cerr << "search: --limit requires a number\n";
+                return 1;
+            }
+            unsigned long n = 0;
+            if (!parse_count(args[i + 1], std::numeric_limits<std::size_t>::max(), n)) {
+                std::cerr << "search: invalid --limit value '" << args[i + 1] << "'\n";
+                return 1;
+            }
+            limit = n;
+            i++;
+            continue;
+        }
+        if (!query.empty()) query += ' ';
         query += args[i];
     }
+    if (query.empty()) {
+        std::cerr << "search: missing <query>\n";
+        print_usage(std::cerr);
+        return 1;
+    }
 
     try {
-        cpp_hub::Registry reg;
+        cpp_hub::RegistrySet reg;
         reg.ensure_initialized();
-        const auto& templates = reg.templates();
-
-        std::vector<const TemplateInfo*> matches;
-        for (const auto& [id, t] : templates) {
-            bool matched = false;
-            if (icontains(t.id, query) ||
-                icontains(t.name, query) ||
-                icontains(t.description, query)) {
-                matched = true;
-            } else {
-                for (const auto& tag : t.tags) {
-                    if (icontains(tag, query)) {
-                        matched = true;
-                        break;
-                    }
-                }
-            }
-            if (matched) {
-                matches.push_back(&t);
-            }
-        }
+        const std::vector<cpp_hub::SearchHit> matches = reg.search(query, limit);
 
         if (matches.empty()) {
             std::cout << "No templates matched query: " << query << "\n";
@@ -176,13 +340,8 @@ static int handle_search(const std::vector<std::string>& args) {
         }
 
         print_template_table_header();
-        for (const auto* t : matches) {
-            std::cout << std::left
-                      << std::setw(20) << t->id.substr(0, 19)
-                      << std::setw(24) << t->name.substr(0, 23)
-                      << std::setw(14) << t->buildSystem.substr(0, 13)
-                      << t->description
-                      << "\n";
+        for (const auto& hit : matches) {
+            print_template_row(reg.at(hit.ordinal));
         }
 
         return 0;
@@ -193,62 +352,54 @@ static int handle_search(const std::vector<std::string>& args) {
 }
 
 static int handle_list(const std::vector<std::string>& args) {
-    std::string tagFilter;
+    cpp_hub::TagQuery query;
 
     for (size_t i = 0; i < args.size(); ++i) {
+        std::vector<std::string>* tags = nullptr;
         if (args[i] == "--tag") {
-            if (i + 1 >= args.size()) {
-                std::cerr << "list: --tag requires a value\n";
-                return 1;
-            }
-            tagFilter = args[i + 1];
-            i++;
+            tags = &query.all;
+        } else if (args[i] == "--any-tag") {
+            tags = &query.any;
+        } else if (args[i] == "--not-tag") {
+            tags = &query.none;
         } else {
             std::cerr << "list: unknown option '" << args[i] << "'\n";
             return 1;
         }
+        if (i + 1 >= args.size()) {
+            std::cerr << "list: " << args[i] << " requires a value\n";
+            return 1;
+        }
+        tags->push_back(args[i + 1]);
+        i++;
     }
+    const bool filtered = !query.all.empty() || !query.any.empty() || !query.none.empty();
 
     try {
-        cpp_hub::Registry reg;
+        cpp_hub::RegistrySet reg;
         reg.ensure_initialized();
-        const auto& templates = reg.templates();
-
-        std::vector<const TemplateInfo*> matches;
-        for (const auto& [id, t] : templates) {
-            if (tagFilter.empty()) {
-                matches.push_back(&t);
-            } else {
-                bool hasTag = false;
-                for (const auto& tag : t.tags) {
-                    if (iequals(tag, tagFilter)) {
-                        hasTag = true;
-                        break;
-                    }
-                }
-                if (hasTag) {
-                    matches.push_back(&t);
-                }
-            }
+        std::vector<std::size_t> matches;
+        if (filtered) {
+            matches = reg.with_tags(query);
+        } else {
+            matches.resize(reg.size());
+            std::iota(matches.begin(), matches.end(), std::size_t{0});
         }
 
         if (matches.empty()) {
-            if (tagFilter.empty()) {
+            if (!filtered) {
                 std::cout << "No templates in registry.\n";
+            } else if (query.all.size() == 1 && query.any.empty() && query.none.empty()) {
+                std::cout << "No templates with tag '" << query.all.front() << "'.\n";
             } else {
-                std::cout << "No templates with tag '" << tagFilter << "'.\n";
+                std::cout << "No templates match the tag filter.\n";
             }
             return 0;
         }
 
         print_template_table_header();
-        for (const auto* t : matches) {
-            std::cout << std::left
-                      << std::setw(20) << t->id.substr(0, 19)
-                      << std::setw(24) << t->name.substr(0, 23)
-                      << std::setw(14) << t->buildSystem.substr(0, 13)
-                      << t->description
-                      << "\n";
+        for (const std::size_t i : matches) {
+            print_template_row(reg.at(i));
         }
 
         return 0;
@@ -298,21 +449,26 @@ static int handle_new_from_registry(const std::vector<std::string>& args) {
     }
 
     std::string templateId = args[0];
-    bool useDefaults = false;
+    GenerationOptions opts;
 
     for (size_t i = 1; i < args.size(); ++i) {
-        if (args[i] == "--defaults") {
-            useDefaults = true;
-        } else {
+        OptionParse parsed = parse_generation_option(args, i, opts);
+        if (parsed == OptionParse::Invalid) {
+            return 1;
+        }
+        if (parsed == OptionParse::Unknown) {
             std::cerr << "new: unknown option '" << args[i] << "'\n";
             return 1;
         }
     }
+    if (!check_generation_options(opts)) {
+        return 1;
+    }
 
     try {
-        cpp_hub::Registry reg;
+        cpp_hub::RegistrySet reg;
         reg.ensure_initialized();
-        const TemplateInfo* info = reg.find_template(templateId);
+        const std::optional<cpp_hub::TemplateView> info = reg.find_template(templateId);
         if (!info) {
             std::cerr << "Template not found in registry: " << templateId << "\n";
             return 1;
@@ -324,19 +480,21 @@ static int handle_new_from_registry(const std::vector<std::string>& args) {
             return 1;
         }
 
-        fs::path tplPath = cacheRoot / info->id;
+        fs::path tplPath = cacheRoot / info->id();
 
         if (!fs::exists(tplPath)) {
-            std::string cmd = "git clone \"" + info->url + "\" \"" + tplPath.string() + "\"";
+            std::string cmd = "git clone \"" + std::string(info->url()) + "\" \"" +
+                              tplPath.string() + "\"";
             if (!util::run_command(cmd)) {
-                std::cerr << "Failed to clone template repository: " << info->url << "\n";
+                std::cerr << "Failed to clone template repository: " << info->url() << "\n";
                 return 1;
             }
+            store_template_files(tplPath, opts.jobs);
         } else {
             std::cout << "Using cached template at " << tplPath << "\n";
         }
 
-        return run_generation(tplPath, useDefaults);
+        return run_generation(tplPath, opts);
     } catch (const std::exception& e) {
         std::cerr << "new failed: " << e.what() << "\n";
         return 1;
@@ -351,7 +509,7 @@ static int handle_new_from_git(const std::vector<std::string>& args) {
     }
     std::string url = args[1];
     std::string branch;
-    bool useDefaults = false;
+    GenerationOptions opts;
 
     for (size_t i = 2; i < args.size(); ++i) {
         if (args[i] == "--branch") {
@@ -361,13 +519,20 @@ static int handle_new_from_git(const std::vector<std::string>& args) {
             }
             branch = args[i + 1];
             ++i;
-        } else if (args[i] == "--defaults") {
-            useDefaults = true;
-        } else {
+            continue;
+        }
+        OptionParse parsed = parse_generation_option(args, i, opts);
+        if (parsed == OptionParse::Invalid) {
+            return 1;
+        }
+        if (parsed == OptionParse::Unknown) {
             std::cerr << "new --git: unknown option '" << args[i] << "'\n";
             return 1;
         }
     }
+    if (!check_generation_options(opts)) {
+        return 1;
+    }
 
     fs::path cacheRoot = cpp_hub::cache_root();
     if (!util::ensure_directory(cacheRoot)) {
@@ -379,6 +544,7 @@ static int handle_new_from_git(const std::vector<std::string>& args) {
     std::string dirName = "git-" + std::to_string(hasher(url + branch));
     fs::path tplPath = cacheRoot / dirName;
 
+    const std::string headBefore = util::head_commit(tplPath);
     if (!fs::exists(tplPath)) {
         std::string cmd = "git clone \"" + url + "\" \"" + tplPath.string() + "\"";
         if (!util::run_command(cmd)) {
@@ -396,26 +562,293 @@ static int handle_new_from_git(const std::vector<std::string>& args) {
             return 1;
         }
     }
+    if (util::head_commit(tplPath) != headBefore) {
+        store_template_files(tplPath, opts.jobs);
+    }
 
-    return run_generation(tplPath, useDefaults);
+    return run_generation(tplPath, opts);
 }
 
-static int run_generation(const fs::path& templateRepoPath, bool useDefaults) {
-    fs::path manifestPath = templateRepoPath / "hub-manifest.json";
+static int handle_regen(const std::vector<std::string>& args) {
+    fs::path projectRoot;
+    GenerationOptions opts;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--set") {
+            const size_t eq = i + 1 < args.size() ? args[i + 1].find('=') : std::string::npos;
+            if (eq == std::string::npos || eq == 0) {
+                std::cerr << "--set expects <name>=<value>\n";
+                return 1;
+            }
+            overrides.emplace_back(args[i + 1].substr(0, eq), args[i + 1].substr(eq + 1));
+            ++i;
+            continue;
+        }
+        OptionParse parsed = parse_generation_option(args, i, opts);
+        if (parsed == OptionParse::Invalid) {
+            return 1;
+        }
+        if (parsed == OptionParse::Consumed) {
+            continue;
+        }
+        if (!args[i].empty() && args[i][0] != '-' && projectRoot.empty()) {
+            projectRoot = args[i];
+            continue;
+        }
+        std::cerr << "regen: unknown option '" << args[i] << "'\n";
+        return 1;
+    }
+    if (opts.plan || !opts.archive.empty() || opts.zstd) {
+        std::cerr << "regen: --plan, --output-archive and --zstd are only supported by new\n";
+        return 1;
+    }
+    projectRoot = fs::absolute(projectRoot.empty() ? fs::current_path() : projectRoot);
+
+    GenerationRecord previous;
+    try {
+        previous = load_generation_record(projectRoot);
+    } catch (const std::exception& e) {
+        std::cerr << "regen: " << e.what() << "\n";
+        return 1;
+    }
+
+    const fs::path templateRepoPath = previous.templatePath;
+    if (!fs::is_directory(templateRepoPath)) {
+        std::cerr << "regen: template checkout " << templateRepoPath
+                  << " no longer exists.\n";
+        return 1;
+    }
+
     TemplateManifest manifest;
+    std::unique_ptr<CompiledTemplate> compiled;
+    IgnoreMatcher ignore;
+    if (!load_template(templateRepoPath, compiled, manifest, ignore)) {
+        return 1;
+    }
 
+    // Recorded values for variables the template still has, then the
+    // overrides; variables added since generation are asked for.
+    std::unordered_map<std::string, std::string> values;
+    TemplateManifest added = manifest;
+    added.variables.clear();
+    for (const auto& vd : manifest.variables) {
+        auto rit = previous.variables.find(vd.name);
+        if (rit != previous.variables.end()) {
+            values[vd.name] = rit->second;
+        } else {
+            added.variables.push_back(vd);
+        }
+    }
+    for (auto& [name, value] : overrides) {
+        auto vit = std::find_if(manifest.variables.begin(), manifest.variables.end(),
+                                [&](const VariableDef& vd) { return vd.name == name; });
+        if (vit == manifest.variables.end()) {
+            std::cerr << "regen: template has no variable '" << name << "'\n";
+            return 1;
+        }
+        if (!validate_variable_value(*vit, value)) {
+            return 1;
+        }
+        values[name] = value;
+        added.variables.erase(
+            std::remove_if(added.variables.begin(), added.variables.end(),
+                           [&](const VariableDef& vd) { return vd.name == name; }),
+            added.variables.end());
+    }
+    if (!added.variables.empty()) {
+        std::unordered_map<std::string, std::string> addedValues;
+        if (!collect_variables_interactively(added, opts.useDefaults, addedValues)) {
+            return 1;
+        }
+        values.insert(addedValues.begin(), addedValues.end());
+    }
+
+    std::vector<fs::path> layers;
+    std::vector<fs::path> overlaySources;
+    GenerationRecord record;
+    select_layers(templateRepoPath, manifest, values, layers, overlaySources, record.overlays);
+    record.templatePath = previous.templatePath;
+    record.templateCommit = compiled ? compiled->head() : util::head_commit(templateRepoPath);
+    record.variables.insert(values.begin(), values.end());
+
+    if (!record.templateCommit.empty() && record.templateCommit == previous.templateCommit &&
+        record.variables == previous.variables && record.overlays == previous.overlays) {
+        std::cout << "Project is up to date.\n";
+        return 0;
+    }
+
+    RegenSummary summary;
+    RenderOptions renderOpts;
+    renderOpts.allowExisting = true;
+    renderOpts.jobs = opts.jobs;
+    renderOpts.compiled = compiled.get();
+    renderOpts.ignore = &ignore;
+    renderOpts.record = &record;
+    renderOpts.previousRecord = &previous;
+    renderOpts.summary = &summary;
+
+    if (!render_layers(layers, overlaySources, projectRoot, values, renderOpts)) {
+        return 1;
+    }
+
+    std::cout << "Regenerated " << projectRoot << ": "
+              << summary.written << " written, "
+              << summary.unchanged << " unchanged, "
+              << summary.removed << " removed.\n";
+    for (const auto& path : summary.kept) {
+        std::cout << "Left alone (edited since generation): " << path << "\n";
+    }
+    return 0;
+}
+
+static OptionParse parse_generation_option(
+    const std::vector<std::string>& args, size_t& i, GenerationOptions& opts) {
+    if (args[i] == "--defaults") {
+        opts.useDefaults = true;
+        return OptionParse::Consumed;
+    }
+    if (args[i] == "--plan") {
+        opts.plan = true;
+        return OptionParse::Consumed;
+    }
+    if (args[i] == "--zstd") {
+        opts.zstd = true;
+        return OptionParse::Consumed;
+    }
+    if (args[i] == "--output-archive") {
+        if (i + 1 >= args.size() || args[i + 1].empty()) {
+            std::cerr << "--output-archive requires a file name (or - for stdout)\n";
+            return OptionParse::Invalid;
+        }
+        opts.archive = args[i + 1];
+        ++i;
+        return OptionParse::Consumed;
+    }
+    if (args[i] == "--jobs") {
+        if (i + 1 >= args.size()) {
+            std::cerr << "--jobs requires a number\n";
+            return OptionParse::Invalid;
+        }
+        unsigned long n = 0;
+        if (!parse_count(args[i + 1], 1024, n)) {
+            std::cerr << "--jobs expects a number between 1 and 1024, got '" << args[i + 1]
+                      << "'\n";
+            return OptionParse::Invalid;
+        }
+        opts.jobs = static_cast<unsigned>(n);
+        ++i;
+        return OptionParse::Consumed;
+    }
+    return OptionParse::Unknown;
+}
+
+// Checks that only make sense once all options are known. When the archive
+// goes to stdout, everything else that would be printed there (prompts
+// included) is sent to stderr instead.
+static bool check_generation_options(GenerationOptions& opts) {
+    if (opts.archive.empty()) {
+        if (opts.zstd) {
+            std::cerr << "--zstd requires --output-archive\n";
+            return false;
+        }
+        return true;
+    }
+    if (opts.plan) {
+        std::cerr << "--plan cannot be combined with --output-archive\n";
+        return false;
+    }
+    const std::string ext = fs::path(opts.archive).extension().string();
+    if (ext == ".zst" || ext == ".tzst") {
+        opts.zstd = true;
+    }
+    if (opts.zstd && !ArchiveOutput::zstd_available()) {
+        std::cerr << "This build of cpp-hub cannot write zstd archives\n";
+        return false;
+    }
+    if (opts.archive == "-") {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    return true;
+}
+
+static bool load_template(const fs::path& templateRepoPath,
+                          std::unique_ptr<CompiledTemplate>& compiled,
+                          TemplateManifest& manifest,
+                          IgnoreMatcher& ignore) {
     try {
-        manifest = load_manifest(manifestPath);
+        // Cached checkouts are compiled once per git HEAD; anything else is
+        // read straight from the tree.
+        compiled = CompiledTemplate::load_or_build(
+            templateRepoPath,
+            cpp_hub::compiled_cache_root() / (templateRepoPath.filename().string() + ".hubc"));
+        manifest = compiled ? compiled->manifest()
+                            : load_manifest(templateRepoPath / "hub-manifest.json");
+        ignore = IgnoreMatcher(load_ignore_patterns(templateRepoPath, manifest));
     } catch (const std::exception& e) {
         std::cerr << "Failed to load manifest: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Base template first, then every overlay whose condition matches.
+// Overlay sources are never rendered as part of the base tree.
+static void select_layers(const fs::path& templateRepoPath,
+                          const TemplateManifest& manifest,
+                          const std::unordered_map<std::string, std::string>& values,
+                          std::vector<fs::path>& layers,
+                          std::vector<fs::path>& overlaySources,
+                          std::vector<std::string>& activeOverlays) {
+    layers = {templateRepoPath};
+    for (const auto& rule : manifest.overlays) {
+        overlaySources.push_back(templateRepoPath / rule.path);
+
+        auto vit = values.find(rule.variable);
+        if (vit == values.end()) {
+            continue;
+        }
+        if (vit->second != rule.equalsValue) {
+            continue;
+        }
+
+        fs::path overlayRoot = templateRepoPath / rule.path;
+        if (!fs::exists(overlayRoot)) {
+            std::cerr << "Warning: overlay path does not exist: " << overlayRoot << "\n";
+            continue;
+        }
+
+        std::cout << "Applying overlay for " << rule.variable
+                  << " == " << rule.equalsValue
+                  << " from " << overlayRoot << "\n";
+        layers.push_back(overlayRoot);
+        activeOverlays.push_back(rule.path);
+    }
+}
+
+static int run_generation(const fs::path& templateRepoPath, const GenerationOptions& opts) {
+    using Clock = std::chrono::steady_clock;
+    const auto manifestStart = Clock::now();
+    TemplateManifest manifest;
+    std::unique_ptr<CompiledTemplate> compiled;
+    IgnoreMatcher ignore;
+    if (!load_template(templateRepoPath, compiled, manifest, ignore)) {
         return 1;
     }
 
+    const auto variableStart = Clock::now();
     std::unordered_map<std::string, std::string> values;
-    if (!collect_variables_interactively(manifest, useDefaults, values)) {
+    if (!collect_variables_interactively(manifest, opts.useDefaults, values)) {
         return 1;
     }
 
+    if (opts.plan) {
+        const auto variableEnd = Clock::now();
+        return run_plan(templateRepoPath, manifest, compiled.get(), ignore, values, opts,
+                        std::chrono::duration<double>(variableStart - manifestStart).count(),
+                        std::chrono::duration<double>(variableEnd - variableStart).count());
+    }
+
     std::string defaultName;
     auto it = values.find("project_name");
     if (it != values.end() && !it->second.empty()) {
@@ -426,6 +859,11 @@ static int run_generation(const fs::path& templateRepoPath, bool useDefaults) {
         defaultName = "cpp-project";
     }
 
+    if (!opts.archive.empty()) {
+        return run_archive(templateRepoPath, manifest, compiled.get(), ignore, values, opts,
+                           defaultName);
+    }
+
     fs::path defaultTarget = fs::current_path() / defaultName;
 
     std::cout << "Target directory [" << defaultTarget.string() << "]: " << std::flush;
@@ -451,38 +889,35 @@ static int run_generation(const fs::path& templateRepoPath, bool useDefaults) {
         return 1;
     }
 
-    // 1) Render base template
-    if (!render_template(templateRepoPath, targetPath, values)) {
+    std::vector<fs::path> layers;
+    std::vector<fs::path> overlaySources;
+    GenerationRecord record;
+    select_layers(templateRepoPath, manifest, values, layers, overlaySources, record.overlays);
+
+    // Remember what the project came from, for `cpp-hub regen`.
+    record.templatePath = fs::absolute(templateRepoPath).string();
+    record.templateCommit = compiled ? compiled->head() : util::head_commit(templateRepoPath);
+    record.variables.insert(values.begin(), values.end());
+
+    RenderOptions renderOpts;
+    renderOpts.jobs = opts.jobs;
+    renderOpts.compiled = compiled.get();
+    renderOpts.ignore = &ignore;
+    renderOpts.record = &record;
+    RenderStats stats;
+    renderOpts.stats = &stats;
+
+    if (!render_layers(layers, overlaySources, targetPath, values, renderOpts)) {
         return 1;
     }
 
-    // 2) Apply overlays (if any) on top, depending on collected variables
-    for (const auto& rule : manifest.overlays) {
-        auto vit = values.find(rule.variable);
-        if (vit == values.end()) {
-            continue;
-        }
-        if (vit->second != rule.equalsValue) {
-            continue;
-        }
-
-        fs::path overlayRoot = templateRepoPath / rule.path;
-        if (!fs::exists(overlayRoot)) {
-            std::cerr << "Warning: overlay path does not exist: " << overlayRoot << "\n";
-            continue;
-        }
-
-        std::cout << "Applying overlay for " << rule.variable
-                  << " == " << rule.equalsValue
-                  << " from " << overlayRoot << "\n";
-
-        if (!render_template(overlayRoot, targetPath, values, /*allowExisting*/ true)) {
-            std::cerr << "Failed to render overlay from " << overlayRoot << "\n";
-            return 1;
-        }
-    }
-
     std::cout << "Project generated at: " << targetPath << "\n";
+    if (util::counting_heap_allocations() && stats.files != 0) {
+        std::cout << "Heap allocations while rendering: " << stats.heapAllocations << " ("
+                  << std::fixed << std::setprecision(1)
+                  << static_cast<double>(stats.heapAllocations) / stats.files
+                  << " per file)\n" << std::defaultfloat;
+    }
 
     if (!manifest.postGenHooks.empty()) {
         for (const auto& cmd : manifest.postGenHooks) {
@@ -519,5 +954,154 @@ static int run_generation(const fs::path& templateRepoPath, bool useDefaults) {
     return 0;
 }
 
-} // namespace cpp_hub::cli
+// Every archive member is stamped with the same time, so rendering the same
+// template twice gives the same bytes: SOURCE_DATE_EPOCH when it is set (as
+// in reproducible builds), otherwise the template's commit time.
+static std::int64_t archive_mtime(const fs::path& templateRepoPath) {
+    if (const char* epoch = std::getenv("SOURCE_DATE_EPOCH")) {
+        try {
+            std::size_t used = 0;
+            const long long seconds = std::stoll(epoch, &used);
+            if (epoch[used] == '\0' && seconds >= 0) {
+                return seconds;
+            }
+        } catch (const std::logic_error&) {
+        }
+        std::cerr << "Warning: ignoring invalid SOURCE_DATE_EPOCH '" << epoch << "'\n";
+    }
+    const std::int64_t commitTime = util::head_commit_time(templateRepoPath);
+    return commitTime < 0 ? 0 : commitTime;
+}
+
+// Render into a tar archive whose members unpack into rootName/, without
+// asking for a target directory. No generation record is added, since the
+// project does not exist yet, and hooks are not run.
+static int run_archive(const fs::path& templateRepoPath,
+                       const TemplateManifest& manifest,
+                       const CompiledTemplate* compiled,
+                       const IgnoreMatcher& ignore,
+                       const std::unordered_map<std::string, std::string>& values,
+                       const GenerationOptions& opts,
+                       const std::string& rootName) {
+    std::vector<fs::path> layers;
+    std::vector<fs::path> overlaySources;
+    std::vector<std::string> activeOverlays;
+    select_layers(templateRepoPath, manifest, values, layers, overlaySources, activeOverlays);
+
+    const fs::path targetPath = fs::path(rootName);
+    std::string error;
+    std::unique_ptr<ArchiveOutput> archive = ArchiveOutput::create(
+        opts.archive, targetPath, archive_mtime(templateRepoPath), opts.zstd,
+        opts.jobs == 0 ? util::default_jobs() : opts.jobs, error);
+    if (!archive) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    RenderOptions renderOpts;
+    renderOpts.jobs = opts.jobs;
+    renderOpts.compiled = compiled;
+    renderOpts.ignore = &ignore;
+    renderOpts.output = archive.get();
+
+    if (!render_layers(layers, overlaySources, targetPath, values, renderOpts) ||
+        !archive->close(error)) {
+        if (!error.empty()) {
+            std::cerr << error << "\n";
+        }
+        archive.reset();
+        if (opts.archive != "-") {
+            std::error_code ec;
+            fs::remove(opts.archive, ec);
+        }
+        return 1;
+    }
+
+    if (opts.archive == "-") {
+        std::cout << "Project written to standard output as an archive\n";
+    } else {
+        std::cout << "Project archive written to: " << fs::path(opts.archive) << "\n";
+    }
+    if (!manifest.postGenHooks.empty()) {
+        std::cout << "Post-generation hooks are not run when writing an archive.\n";
+    }
+    return 0;
+}
 
+// Print what run_generation would write, and how long each phase took,
+// without asking for a target directory or writing anything.
+static int run_plan(const fs::path& templateRepoPath,
+                    const TemplateManifest& manifest,
+                    const CompiledTemplate* compiled,
+                    const IgnoreMatcher& ignore,
+                    const std::unordered_map<std::string, std::string>& values,
+                    const GenerationOptions& opts,
+                    double manifestSeconds,
+                    double variableSeconds) {
+    using Clock = std::chrono::steady_clock;
+    const auto overlayStart = Clock::now();
+    std::vector<fs::path> layers;
+    std::vector<fs::path> overlaySources;
+    std::vector<std::string> activeOverlays;
+    select_layers(templateRepoPath, manifest, values, layers, overlaySources, activeOverlays);
+    const double overlaySeconds =
+        std::chrono::duration<double>(Clock::now() - overlayStart).count();
+
+    RenderOptions renderOpts;
+    renderOpts.jobs = opts.jobs;
+    renderOpts.compiled = compiled;
+    renderOpts.ignore = &ignore;
+    RenderPlan plan;
+    if (!plan_layers(layers, overlaySources, values, renderOpts, plan)) {
+        return 1;
+    }
+
+    size_t pathWidth = 12;
+    for (const auto& f : plan.files) {
+        pathWidth = std::max(pathWidth, f.destRel.size() + 2);
+    }
+
+    std::cout << std::left << std::setw(static_cast<int>(pathWidth)) << "DESTINATION"
+              << std::right << std::setw(14) << "BYTES"
+              << std::setw(10) << "TOKENS"
+              << "  ACTION\n";
+    std::cout << std::string(pathWidth + 14 + 10 + 12, '-') << "\n";
+
+    std::uint64_t inputBytes = 0;
+    std::uint64_t outputBytes = 0;
+    size_t tokens = 0;
+    size_t substituted = 0;
+    for (const auto& f : plan.files) {
+        std::cout << std::left << std::setw(static_cast<int>(pathWidth)) << f.destRel
+                  << std::right << std::setw(14) << f.outputBytes
+                  << std::setw(10) << f.tokens
+                  << "  " << (f.verbatim ? "verbatim" : "substitute") << "\n";
+        inputBytes += f.bytes;
+        outputBytes += f.outputBytes;
+        tokens += f.tokens;
+        substituted += f.verbatim ? 0 : 1;
+    }
+
+    std::cout << "\nTotal: " << plan.files.size() << " files in " << plan.directories
+              << " directories, " << substituted << " substituted, "
+              << plan.files.size() - substituted << " verbatim; "
+              << inputBytes << " bytes read, " << outputBytes << " bytes written, "
+              << tokens << " tokens.\n";
+
+    auto phase = [](const char* name, double seconds) {
+        std::cout << "  " << std::left << std::setw(22) << name << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(10)
+                  << seconds * 1000.0 << " ms\n";
+    };
+    std::cout << "\nPhases:\n";
+    phase("manifest loading", manifestSeconds);
+    phase("variable resolution", variableSeconds);
+    phase("overlay selection", overlaySeconds);
+    phase("path substitution", plan.collectSeconds);
+    phase("content scan", plan.scanSeconds);
+    std::cout << "  (scan kernel: " << scan_kernel_name() << ", "
+              << (compiled ? "compiled template" : "walked template") << ")\n";
+    return 0;
+}
+
+} // namespace cpp_hub::cli
@@ -0,0 +1,570 @@
+// src/core/archive_output.cpp
+#include "cpp_hub/archive_output.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#ifdef CPP_HUB_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+constexpr std::size_t kBlockSize = 512;
+// Largest size the 11 octal digits of a ustar size field can hold.
+constexpr std::uint64_t kMaxUstarSize = 077777777777ull;
+// Read size when copying a spooled stream into the archive.
+constexpr std::size_t kCopyChunkSize = 64 << 10;
+// Rendered files that must wait for earlier ones are kept in memory up to
+// this total, and spooled to temporary files beyond it.
+constexpr std::uint64_t kMaxPendingBytes = 64 << 20;
+// Buffers of written-out pending files kept for reuse.
+constexpr std::size_t kSpareBuffers = 16;
+
+struct UstarHeader {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+static_assert(sizeof(UstarHeader) == kBlockSize, "ustar header must be one block");
+
+template <std::size_t N>
+void put_octal(char (&field)[N], std::uint64_t value) {
+    std::snprintf(field, N, "%0*llo", static_cast<int>(N - 1),
+                  static_cast<unsigned long long>(value));
+}
+
+// Split a member name into the ustar prefix and name fields, cutting at a
+// slash. Returns false if it does not fit and needs a pax "path" record.
+bool split_name(const std::string& full, std::string& prefix, std::string& name) {
+    if (full.size() <= sizeof(UstarHeader::name)) {
+        prefix.clear();
+        name = full;
+        return true;
+    }
+    // Cutting further left only makes the name part longer. A directory's
+    // trailing slash stays in the name part, so the search starts before it.
+    const std::size_t cut =
+        full.rfind('/', std::min(sizeof(UstarHeader::prefix), full.size() - 2));
+    if (cut == std::string::npos || cut == 0 ||
+        full.size() - cut - 1 > sizeof(UstarHeader::name) || full.size() - cut - 1 == 0) {
+        return false;
+    }
+    prefix = full.substr(0, cut);
+    name = full.substr(cut + 1);
+    return true;
+}
+
+// Append a "<length> <key>=<value>\n" record, where length counts itself.
+void add_pax_record(std::string& pax, std::string_view key, std::string_view value) {
+    const std::size_t body = key.size() + value.size() + 3; // ' ', '=' and '\n'
+    std::size_t length = body + 1;
+    while (std::to_string(length).size() + body != length) {
+        length = std::to_string(length).size() + body;
+    }
+    pax += std::to_string(length);
+    pax += ' ';
+    pax += key;
+    pax += '=';
+    pax += value;
+    pax += '\n';
+}
+
+std::string errno_message(const char* what, const fs::path& p, int err) {
+    std::ostringstream os;
+    os << what << " " << p << ": " << std::generic_category().message(err);
+    return os.str();
+}
+
+// Spools a streamed file to an unnamed temporary file, since a tar header
+// needs the size before the data, then appends it in one go.
+class SpoolStream final : public OutputStream {
+public:
+    SpoolStream(ArchiveOutput& owner, std::size_t tag, fs::path dest, fs::perms perms,
+                std::FILE* spool)
+        : owner_(owner), tag_(tag), dest_(std::move(dest)), perms_(perms), spool_(spool) {}
+
+    ~SpoolStream() override {
+        if (spool_) {
+            std::fclose(spool_);
+        }
+    }
+
+    bool write(std::string_view data, std::string& error) override {
+        if (!data.empty() && std::fwrite(data.data(), 1, data.size(), spool_) != data.size()) {
+            error = errno_message("Failed to spool file", dest_, errno);
+            return false;
+        }
+        size_ += data.size();
+        return true;
+    }
+
+    bool close(std::string& error) override {
+        if (std::fflush(spool_) != 0 || std::fseek(spool_, 0, SEEK_SET) != 0) {
+            error = errno_message("Failed to spool file", dest_, errno);
+            return false;
+        }
+        std::FILE* spool = spool_;
+        spool_ = nullptr;
+        return owner_.append_file(tag_, dest_, size_, perms_, spool, error);
+    }
+
+private:
+    ArchiveOutput& owner_;
+    std::size_t tag_;
+    fs::path dest_;
+    fs::perms perms_;
+    std::FILE* spool_;
+    std::uint64_t size_ = 0;
+};
+
+} // namespace
+
+// The byte stream under the archive: a file or stdout, optionally zstd.
+class ArchiveSink {
+public:
+    ArchiveSink() = default;
+    ArchiveSink(const ArchiveSink&) = delete;
+    ArchiveSink& operator=(const ArchiveSink&) = delete;
+
+    ~ArchiveSink() {
+#ifdef CPP_HUB_HAVE_ZSTD
+        ZSTD_freeCCtx(zstd_);
+#endif
+        if (file_ && file_ != stdout) {
+            std::fclose(file_);
+        }
+    }
+
+    bool open(const fs::path& archive, bool zstd, unsigned jobs, std::string& error) {
+        path_ = archive;
+        if (archive == "-") {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            file_ = stdout;
+        } else {
+#ifdef _WIN32
+            file_ = _wfopen(archive.c_str(), L"wb");
+#else
+            file_ = std::fopen(archive.c_str(), "wb");
+#endif
+            if (!file_) {
+                error = errno_message("Failed to create archive", archive, errno);
+                return false;
+            }
+        }
+
+        if (zstd) {
+#ifdef CPP_HUB_HAVE_ZSTD
+            zstd_ = ZSTD_createCCtx();
+            if (!zstd_) {
+                error = "Failed to set up zstd compression";
+                return false;
+            }
+            ZSTD_CCtx_setParameter(zstd_, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+            // Fails harmlessly if libzstd was built without threads.
+            ZSTD_CCtx_setParameter(zstd_, ZSTD_c_nbWorkers, jobs > 1 ? static_cast<int>(jobs) : 0);
+            buffer_.resize(ZSTD_CStreamOutSize());
+#else
+            (void)jobs;
+            error = "This build of cpp-hub cannot write zstd archives";
+            return false;
+#endif
+        }
+        return true;
+    }
+
+    bool write(const char* data, std::size_t size, std::string& error) {
+#ifdef CPP_HUB_HAVE_ZSTD
+        if (zstd_) {
+            ZSTD_inBuffer in{data, size, 0};
+            while (in.pos < in.size) {
+                if (!compress(in, ZSTD_e_continue, error)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+#endif
+        return write_raw(data, size, error);
+    }
+
+    bool finish(std::string& error) {
+#ifdef CPP_HUB_HAVE_ZSTD
+        if (zstd_) {
+            ZSTD_inBuffer in{nullptr, 0, 0};
+            std::size_t remaining = 1;
+            while (remaining != 0) {
+                if (!compress(in, ZSTD_e_end, error, &remaining)) {
+                    return false;
+                }
+            }
+        }
+#endif
+        if (std::fflush(file_) != 0) {
+            error = errno_message("Failed to write archive", path_, errno);
+            return false;
+        }
+        if (file_ != stdout) {
+            const int rc = std::fclose(file_);
+            file_ = nullptr;
+            if (rc != 0) {
+                error = errno_message("Failed to write archive", path_, errno);
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool write_raw(const char* data, std::size_t size, std::string& error) {
+        if (size != 0 && std::fwrite(data, 1, size, file_) != size) {
+            error = errno_message("Failed to write archive", path_, errno);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef CPP_HUB_HAVE_ZSTD
+    bool compress(ZSTD_inBuffer& in, ZSTD_EndDirective mode, std::string& error,
+                  std::size_t* remaining = nullptr) {
+        ZSTD_outBuffer out{buffer_.data(), buffer_.size(), 0};
+        const std::size_t rc = ZSTD_compressStream2(zstd_, &out, &in, mode);
+        if (ZSTD_isError(rc)) {
+            error = std::string("zstd compression failed: ") + ZSTD_getErrorName(rc);
+            return false;
+        }
+        if (remaining) {
+            *remaining = rc;
+        }
+        return write_raw(buffer_.data(), out.pos, error);
+    }
+
+    ZSTD_CCtx* zstd_ = nullptr;
+    std::vector<char> buffer_;
+#endif
+
+    fs::path path_;
+    std::FILE* file_ = nullptr;
+};
+
+bool ArchiveOutput::zstd_available() {
+#ifdef CPP_HUB_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<ArchiveOutput> ArchiveOutput::create(
+    const fs::path& archive,
+    const fs::path& targetRoot,
+    std::int64_t mtime,
+    bool zstd,
+    unsigned jobs,
+    std::string& error) {
+
+    auto sink = std::make_unique<ArchiveSink>();
+    if (!sink->open(archive, zstd, jobs, error)) {
+        return nullptr;
+    }
+    return std::unique_ptr<ArchiveOutput>(
+        new ArchiveOutput(std::move(sink), targetRoot, mtime));
+}
+
+ArchiveOutput::ArchiveOutput(std::unique_ptr<ArchiveSink> sink, fs::path root,
+                             std::int64_t mtime)
+    : sink_(std::move(sink)),
+      root_(std::move(root)),
+      mtime_(mtime < 0 ? 0 : mtime) {}
+
+ArchiveOutput::~ArchiveOutput() {
+    for (auto& [tag, member] : pending_) {
+        if (member.spool) {
+            std::fclose(member.spool);
+        }
+    }
+}
+
+std::string ArchiveOutput::member_name(const fs::path& dest) const {
+    const fs::path root = root_.lexically_normal();
+    std::string name = root.filename().empty() ? root.parent_path().filename().generic_string()
+                                               : root.filename().generic_string();
+    const std::string rel = dest.lexically_normal().lexically_relative(root).generic_string();
+    if (!rel.empty() && rel != ".") {
+        name += '/';
+        name += rel;
+    }
+    return name;
+}
+
+bool ArchiveOutput::put_data(std::string_view data, std::string& error) {
+    return sink_->write(data.data(), data.size(), error);
+}
+
+bool ArchiveOutput::put_padding(std::uint64_t size, std::string& error) {
+    static const char zeros[kBlockSize] = {};
+    const std::size_t tail = static_cast<std::size_t>(size % kBlockSize);
+    return tail == 0 || sink_->write(zeros, kBlockSize - tail, error);
+}
+
+bool ArchiveOutput::put_header(const std::string& name, char type, std::uint64_t size,
+                               unsigned mode, std::string& error) {
+    std::string prefix;
+    std::string shortName;
+    std::string pax;
+    if (!split_name(name, prefix, shortName)) {
+        add_pax_record(pax, "path", name);
+        prefix.clear();
+        shortName = name.substr(0, sizeof(UstarHeader::name));
+    }
+    if (size > kMaxUstarSize) {
+        add_pax_record(pax, "size", std::to_string(size));
+    }
+    if (!pax.empty()) {
+        if (!put_header("PaxHeader/" + shortName.substr(0, 80), 'x', pax.size(), 0644, error) ||
+            !put_data(pax, error) || !put_padding(pax.size(), error)) {
+            return false;
+        }
+    }
+
+    UstarHeader h{};
+    std::memcpy(h.name, shortName.data(), std::min(shortName.size(), sizeof(h.name)));
+    std::memcpy(h.prefix, prefix.data(), std::min(prefix.size(), sizeof(h.prefix)));
+    put_octal(h.mode, mode & 07777);
+    put_octal(h.uid, 0);
+    put_octal(h.gid, 0);
+    put_octal(h.size, size > kMaxUstarSize ? 0 : size);
+    put_octal(h.mtime, static_cast<std::uint64_t>(mtime_));
+    h.typeflag = type;
+    std::memcpy(h.magic, "ustar", 6);
+    std::memcpy(h.version, "00", 2);
+
+    std::memset(h.chksum, ' ', sizeof(h.chksum));
+    unsigned sum = 0;
+    const auto* bytes = reinterpret_cast<const unsigned char*>(&h);
+    for (std::size_t i = 0; i < sizeof(h); ++i) {
+        sum += bytes[i];
+    }
+    std::snprintf(h.chksum, sizeof(h.chksum), "%06o", sum);
+    h.chksum[7] = ' ';
+
+    return sink_->write(reinterpret_cast<const char*>(&h), sizeof(h), error);
+}
+
+bool ArchiveOutput::create_directories(const std::vector<fs::path>& dirs, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto add = [&](const fs::path& dir) {
+        std::string name = member_name(dir) + '/';
+        return !directories_.insert(name).second || put_header(name, '5', 0, 0755, error);
+    };
+    if (!add(root_)) {
+        return false;
+    }
+    for (const auto& dir : dirs) {
+        if (!add(dir)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ArchiveOutput::put_spooled(const std::string& name, std::uint64_t size, unsigned mode,
+                                std::FILE* spool, std::string& error) {
+    if (!put_header(name, '0', size, mode, error)) {
+        return false;
+    }
+    std::vector<char> chunk(kCopyChunkSize);
+    for (std::uint64_t left = size; left > 0;) {
+        const std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(left, chunk.size()));
+        if (std::fread(chunk.data(), 1, want, spool) != want) {
+            error = errno_message("Failed to read spooled file", name, errno ? errno : EIO);
+            return false;
+        }
+        if (!sink_->write(chunk.data(), want, error)) {
+            return false;
+        }
+        left -= want;
+    }
+    return put_padding(size, error);
+}
+
+bool ArchiveOutput::put_pending(PendingMember& member, std::string& error) {
+    if (member.spool) {
+        const bool ok = put_spooled(member.name, member.size, member.mode, member.spool, error);
+        std::fclose(member.spool);
+        member.spool = nullptr;
+        return ok;
+    }
+    const std::string_view data = member.mapped.is_open() ? member.mapped.view()
+                                                          : std::string_view(member.data);
+    if (!put_header(member.name, '0', data.size(), member.mode, error) ||
+        !put_data(data, error) || !put_padding(data.size(), error)) {
+        return false;
+    }
+    if (!member.mapped.is_open()) {
+        pendingBytes_ -= member.data.size();
+        if (spareBuffers_.size() < kSpareBuffers) {
+            member.data.clear();
+            spareBuffers_.push_back(std::move(member.data));
+        }
+    }
+    return true;
+}
+
+bool ArchiveOutput::add_member(std::size_t tag, PendingMember member, std::string& error) {
+    if (tag != nextTag_) {
+        pending_.emplace(tag, std::move(member));
+        return true;
+    }
+    if (!put_pending(member, error)) {
+        return false;
+    }
+    ++nextTag_;
+    return flush_pending(error);
+}
+
+bool ArchiveOutput::flush_pending(std::string& error) {
+    while (!pending_.empty() && pending_.begin()->first == nextTag_) {
+        auto node = pending_.extract(pending_.begin());
+        if (!put_pending(node.mapped(), error)) {
+            return false;
+        }
+        ++nextTag_;
+    }
+    return true;
+}
+
+bool ArchiveOutput::write_file(std::size_t tag, const fs::path& dest, std::string& data,
+                               fs::perms perms, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tag == nextTag_) {
+        if (!put_header(member_name(dest), '0', data.size(), static_cast<unsigned>(perms),
+                        error) ||
+            !put_data(data, error) || !put_padding(data.size(), error)) {
+            return false;
+        }
+        ++nextTag_;
+        return flush_pending(error);
+    }
+
+    // Too early: keep the output, taking data's buffer rather than copying
+    // it, until the files before it are in.
+    PendingMember member{member_name(dest), data.size(), static_cast<unsigned>(perms)};
+    if (pendingBytes_ + data.size() > kMaxPendingBytes) {
+        member.spool = std::tmpfile();
+        if (!member.spool ||
+            std::fwrite(data.data(), 1, data.size(), member.spool) != data.size() ||
+            std::fflush(member.spool) != 0 || std::fseek(member.spool, 0, SEEK_SET) != 0) {
+            error = errno_message("Failed to spool file", dest, errno);
+            if (member.spool) {
+                std::fclose(member.spool);
+            }
+            return false;
+        }
+    } else {
+        pendingBytes_ += data.size();
+        member.data.swap(data);
+        if (!spareBuffers_.empty()) {
+            data.swap(spareBuffers_.back());
+            spareBuffers_.pop_back();
+        }
+    }
+    return add_member(tag, std::move(member), error);
+}
+
+bool ArchiveOutput::copy_file(std::size_t tag, const fs::path& src, const fs::path& dest,
+                              std::string_view content, fs::perms perms, std::string& error) {
+    // Verbatim files go from their mapping straight into the stream. One
+    // that must wait for earlier files keeps a mapping of its own until then.
+    PendingMember member{member_name(dest), 0, static_cast<unsigned>(perms)};
+    auto map_source = [&] {
+        std::error_code ec;
+        if (!member.mapped.open(src, ec)) {
+            error = errno_message("Failed to open template file", src, ec.value());
+            return false;
+        }
+        member.mode = static_cast<unsigned>(member.mapped.permissions());
+        return true;
+    };
+    if (content.empty() && !map_source()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tag == nextTag_) {
+        const std::string_view data = member.mapped.is_open() ? member.mapped.view() : content;
+        if (!put_header(member.name, '0', data.size(), member.mode, error) ||
+            !put_data(data, error) || !put_padding(data.size(), error)) {
+            return false;
+        }
+        ++nextTag_;
+        return flush_pending(error);
+    }
+    if (!member.mapped.is_open() && !map_source()) {
+        return false;
+    }
+    return add_member(tag, std::move(member), error);
+}
+
+std::unique_ptr<OutputStream> ArchiveOutput::open_stream(std::size_t tag, const fs::path& dest,
+                                                         fs::perms perms, std::string& error) {
+    std::FILE* spool = std::tmpfile();
+    if (!spool) {
+        error = errno_message("Failed to spool file", dest, errno);
+        return nullptr;
+    }
+    return std::make_unique<SpoolStream>(*this, tag, dest, perms, spool);
+}
+
+bool ArchiveOutput::append_file(std::size_t tag, const fs::path& dest, std::uint64_t size,
+                                fs::perms perms, std::FILE* spool, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PendingMember member{member_name(dest), size, static_cast<unsigned>(perms)};
+    member.spool = spool;
+    return add_member(tag, std::move(member), error);
+}
+
+bool ArchiveOutput::close(std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Files that never arrived cannot hold up the rest.
+    while (!pending_.empty()) {
+        auto node = pending_.extract(pending_.begin());
+        if (!put_pending(node.mapped(), error)) {
+            return false;
+        }
+    }
+    static const char trailer[2 * kBlockSize] = {};
+    return sink_->write(trailer, sizeof(trailer), error) && sink_->finish(error);
+}
+
+} // namespace cpp_hub
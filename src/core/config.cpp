@@ -20,10 +20,26 @@ fs::path registry_path() {
     return config_root() / "registry";
 }
 
+fs::path registries_config_path() {
+    return config_root() / "registries.json";
+}
+
+fs::path registries_root() {
+    return config_root() / "registries";
+}
+
 fs::path cache_root() {
     return config_root() / "cache";
 }
 
+fs::path compiled_cache_root() {
+    return config_root() / "compiled";
+}
+
+fs::path objects_root() {
+    return config_root() / "objects";
+}
+
 std::string version() {
 #ifdef CPP_HUB_VERSION
     return CPP_HUB_VERSION;
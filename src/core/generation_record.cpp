@@ -0,0 +1,443 @@
+// src/core/generation_record.cpp
+#include "cpp_hub/generation_record.hpp"
+#include "cpp_hub/util/fs.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+namespace cpp_hub {
+
+namespace {
+
+// 64-bit FNV-1a. Records only need to notice that a file changed, and this
+// can be computed incrementally over streamed output.
+class ContentHasher {
+public:
+    void update(std::string_view data) {
+        for (unsigned char c : data) {
+            hash_ = (hash_ ^ c) * 0x100000001b3ull;
+        }
+    }
+
+    std::uint64_t digest() const { return hash_; }
+
+private:
+    std::uint64_t hash_ = 0xcbf29ce484222325ull;
+};
+
+// Hashes what is streamed through it. When regenerating, the output goes to
+// a temporary file next to dest that replaces dest only if it has to be
+// written, since that is only known once all of it has been seen.
+class RecordingStream final : public OutputStream {
+public:
+    RecordingStream(RecordingOutput& owner, std::unique_ptr<OutputStream> inner,
+                    fs::path dest, fs::path staged, fs::perms perms)
+        : owner_(owner), inner_(std::move(inner)),
+          dest_(std::move(dest)), staged_(std::move(staged)), perms_(perms) {}
+
+    ~RecordingStream() override {
+        if (!staged_.empty() && inner_) {
+            std::string ignored;
+            inner_->close(ignored);
+            std::error_code ec;
+            fs::remove(staged_, ec);
+        }
+    }
+
+    bool write(std::string_view data, std::string& error) override {
+        hasher_.update(data);
+        return inner_->write(data, error);
+    }
+
+    bool close(std::string& error) override {
+        const bool ok = inner_->close(error);
+        inner_.reset();
+        if (!ok) {
+            return false;
+        }
+        const bool keep = owner_.claim(dest_, hasher_.digest(), perms_);
+        if (staged_.empty()) {
+            return true;
+        }
+        std::error_code ec;
+        if (keep) {
+            fs::rename(staged_, dest_, ec);
+        } else {
+            fs::remove(staged_, ec);
+        }
+        if (ec) {
+            std::ostringstream os;
+            os << "Failed to write file " << dest_ << ": " << ec.message();
+            error = os.str();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    RecordingOutput& owner_;
+    std::unique_ptr<OutputStream> inner_;
+    fs::path dest_;
+    fs::path staged_; // empty when writing to dest directly
+    fs::perms perms_;
+    ContentHasher hasher_;
+};
+
+// The textual form stored in records, e.g. "fnv1a64:0123456789abcdef".
+struct HashText {
+    char text[32];
+
+    explicit HashText(std::uint64_t hash) {
+        std::snprintf(text, sizeof(text), "fnv1a64:%016llx",
+                      static_cast<unsigned long long>(hash));
+    }
+
+    std::string_view view() const { return text; }
+};
+
+// True if rel has no empty, "." or ".." components, i.e. normalizing it
+// would not change it.
+bool is_normal_relative(std::string_view rel) {
+    for (;;) {
+        const std::size_t slash = rel.find('/');
+        const std::string_view part = rel.substr(0, slash);
+        if (part.empty() || part == "." || part == "..") {
+            return false;
+        }
+        if (slash == std::string_view::npos) {
+            return true;
+        }
+        rel.remove_prefix(slash + 1);
+    }
+}
+
+std::string relative_key(const fs::path& p, const fs::path& root) {
+    return p.lexically_normal().lexically_relative(root.lexically_normal()).generic_string();
+}
+
+// Modes are stored as octal strings, e.g. "755".
+std::string mode_text(fs::perms perms) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "%03o",
+                  static_cast<unsigned>(perms & fs::perms::mask));
+    return text;
+}
+
+fs::perms parse_mode(const std::string& text) {
+    std::size_t used = 0;
+    const unsigned long mode = std::stoul(text, &used, 8);
+    if (used != text.size() || mode > static_cast<unsigned long>(fs::perms::mask)) {
+        throw std::invalid_argument("bad mode");
+    }
+    return static_cast<fs::perms>(mode);
+}
+
+} // namespace
+
+std::string content_hash(std::string_view data) {
+    return std::string(HashText(content_digest(data)).view());
+}
+
+std::uint64_t content_digest(std::string_view data) {
+    ContentHasher hasher;
+    hasher.update(data);
+    return hasher.digest();
+}
+
+bool hash_file(const fs::path& file, std::string& hash, fs::perms* perms) {
+    util::MappedFile in;
+    std::error_code ec;
+    if (!in.open(file, ec)) {
+        return false;
+    }
+    hash = content_hash(in.view());
+    if (perms) {
+        *perms = in.permissions() & fs::perms::mask;
+    }
+    return true;
+}
+
+GenerationRecord load_generation_record(const fs::path& projectRoot) {
+    const fs::path path = projectRoot / fs::path(kGenerationRecordPath);
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("No generation record at " + path.string() +
+                                 " (was the project generated by cpp-hub?)");
+    }
+
+    GenerationRecord record;
+    try {
+        json j;
+        in >> j;
+        const json& tpl = j.at("template");
+        record.templatePath = tpl.at("path").get<std::string>();
+        record.templateCommit = tpl.at("commit").get<std::string>();
+        record.variables = j.at("variables").get<std::map<std::string, std::string>>();
+        record.overlays = j.at("overlays").get<std::vector<std::string>>();
+        record.files = j.at("files").get<std::map<std::string, std::string>>();
+        if (j.contains("modes")) {
+            for (const auto& [rel, mode] :
+                 j.at("modes").get<std::map<std::string, std::string>>()) {
+                record.modes.emplace(rel, parse_mode(mode));
+            }
+        }
+    } catch (const json::exception& e) {
+        throw std::runtime_error("Malformed generation record " + path.string() + ": " +
+                                 e.what());
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("Malformed generation record " + path.string() +
+                                 ": invalid file mode");
+    }
+    return record;
+}
+
+void save_generation_record(const fs::path& projectRoot, const GenerationRecord& record) {
+    json j;
+    j["schema_version"] = "1";
+    j["template"] = {{"path", record.templatePath}, {"commit", record.templateCommit}};
+    j["variables"] = record.variables;
+    j["overlays"] = record.overlays;
+    j["files"] = record.files;
+    json modes = json::object();
+    for (const auto& [rel, perms] : record.modes) {
+        modes[rel] = mode_text(perms);
+    }
+    j["modes"] = std::move(modes);
+
+    const fs::path path = projectRoot / fs::path(kGenerationRecordPath);
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    const fs::perms perms = fs::perms::owner_read | fs::perms::owner_write |
+                            fs::perms::group_read | fs::perms::others_read;
+    if (!util::write_file(path, j.dump(2) + "\n", perms, ec)) {
+        throw std::runtime_error("Failed to write generation record " + path.string() + ": " +
+                                 ec.message());
+    }
+}
+
+RecordingOutput::RecordingOutput(OutputBackend& inner, fs::path targetRoot,
+                                 const GenerationRecord* previous)
+    : inner_(inner), targetRoot_(std::move(targetRoot)), previous_(previous) {
+    rootPrefix_ = targetRoot_.lexically_normal().native();
+    if (!rootPrefix_.empty() && rootPrefix_.back() != fs::path::preferred_separator) {
+        rootPrefix_ += fs::path::preferred_separator;
+    }
+}
+
+std::string RecordingOutput::key_of(const fs::path& dest) const {
+#ifndef _WIN32
+    // The renderer passes targetRoot / relative path, so this is normally a
+    // plain prefix cut.
+    const std::string& native = dest.native();
+    if (native.size() > rootPrefix_.size() &&
+        native.compare(0, rootPrefix_.size(), rootPrefix_) == 0) {
+        const std::string_view rel = std::string_view(native).substr(rootPrefix_.size());
+        if (is_normal_relative(rel)) {
+            return std::string(rel);
+        }
+    }
+#endif
+    return relative_key(dest, targetRoot_);
+}
+
+fs::perms RecordingOutput::previous_mode(const std::string& rel, const fs::path& dest) const {
+    const auto mode = previous_->modes.find(rel);
+    if (mode != previous_->modes.end()) {
+        return mode->second;
+    }
+    // Records from before modes were kept: outputs got the template's mode,
+    // so take the one the file has now.
+    std::error_code ec;
+    const fs::file_status status = fs::status(dest, ec);
+    return ec ? fs::perms::unknown : status.permissions() & fs::perms::mask;
+}
+
+bool RecordingOutput::claim(const fs::path& dest, std::uint64_t hash, fs::perms perms) {
+    const HashText text(hash);
+    perms &= fs::perms::mask;
+    std::string rel = key_of(dest);
+    if (!previous_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.insert_or_assign(std::move(rel), Output{hash, perms});
+        ++summary_.written;
+        return true;
+    }
+
+    const auto prev = previous_->files.find(rel);
+    const bool recorded = prev != previous_->files.end();
+    const fs::perms prevPerms = recorded ? previous_mode(rel, dest) : fs::perms::unknown;
+    if (recorded && prev->second == text.view() && prevPerms == perms) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.insert_or_assign(std::move(rel), Output{hash, perms});
+        ++summary_.unchanged;
+        return false;
+    }
+
+    // The output changed (or is new): only replace what is still exactly as
+    // generated last time.
+    std::error_code ec;
+    const bool exists = fs::exists(dest, ec);
+    std::string onDisk;
+    fs::perms onDiskPerms = fs::perms::unknown;
+    const bool readable = exists && hash_file(dest, onDisk, &onDiskPerms);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (recorded ? (readable && onDisk == prev->second && onDiskPerms == prevPerms)
+                 : !exists) {
+        files_.insert_or_assign(std::move(rel), Output{hash, perms});
+        ++summary_.written;
+        return true;
+    }
+    if (!recorded && readable && onDisk == text.view() && onDiskPerms == perms) {
+        files_.insert_or_assign(std::move(rel), Output{hash, perms});
+        ++summary_.unchanged;
+        return false;
+    }
+    // Keep recording the old hash and mode, so the file stays "edited"
+    // until the user's version matches what was generated again.
+    if (recorded) {
+        keptHashes_[rel] = prev->second;
+        const auto mode = previous_->modes.find(rel);
+        if (mode != previous_->modes.end()) {
+            keptModes_[rel] = mode->second;
+        }
+    }
+    summary_.kept.push_back(std::move(rel));
+    return false;
+}
+
+bool RecordingOutput::create_directories(const std::vector<fs::path>& dirs,
+                                         std::string& error) {
+    return inner_.create_directories(dirs, error);
+}
+
+bool RecordingOutput::write_file(std::size_t tag, const fs::path& dest, std::string& data,
+                                 fs::perms perms, std::string& error) {
+    ContentHasher hasher;
+    hasher.update(data);
+    if (!claim(dest, hasher.digest(), perms)) {
+        return true;
+    }
+    return inner_.write_file(tag, dest, data, perms, error);
+}
+
+bool RecordingOutput::copy_file(std::size_t tag, const fs::path& src, const fs::path& dest,
+                                std::string_view content, fs::perms perms,
+                                std::string& error) {
+    ContentHasher hasher;
+    util::MappedFile in;
+    if (content.empty()) {
+        std::error_code ec;
+        if (!in.open(src, ec)) {
+            std::ostringstream os;
+            os << "Failed to open template file " << src;
+            error = os.str();
+            return false;
+        }
+        hasher.update(in.view());
+        in.close();
+    } else {
+        hasher.update(content);
+    }
+    if (!claim(dest, hasher.digest(), perms)) {
+        return true;
+    }
+    return inner_.copy_file(tag, src, dest, content, perms, error);
+}
+
+bool RecordingOutput::copy_known_file(std::size_t tag, const fs::path& src,
+                                      const fs::path& dest, std::string_view content,
+                                      std::uint64_t digest, fs::perms perms,
+                                      std::string& error) {
+    if (!claim(dest, digest, perms)) {
+        return true;
+    }
+    return inner_.copy_file(tag, src, dest, content, perms, error);
+}
+
+std::unique_ptr<OutputStream> RecordingOutput::open_stream(std::size_t tag, const fs::path& dest,
+                                                           fs::perms perms, std::string& error) {
+    fs::path staged;
+    if (previous_) {
+        staged = dest;
+        staged += ".cpp-hub-new";
+    }
+    std::unique_ptr<OutputStream> inner =
+        inner_.open_stream(tag, staged.empty() ? dest : staged, perms, error);
+    if (!inner) {
+        return nullptr;
+    }
+    return std::make_unique<RecordingStream>(*this, std::move(inner), dest, std::move(staged),
+                                             perms);
+}
+
+std::vector<OutputFailure> RecordingOutput::finish() {
+    return inner_.finish();
+}
+
+bool RecordingOutput::complete(GenerationRecord& record, RegenSummary* summary,
+                               std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (previous_) {
+        for (const auto& [rel, hash] : previous_->files) {
+            if (files_.count(rel) != 0 || keptHashes_.count(rel) != 0) {
+                continue;
+            }
+            const fs::path path = targetRoot_ / fs::path(rel);
+            std::error_code ec;
+            if (!fs::exists(path, ec)) {
+                continue;
+            }
+            std::string onDisk;
+            fs::perms onDiskPerms = fs::perms::unknown;
+            const auto mode = previous_->modes.find(rel);
+            if (!hash_file(path, onDisk, &onDiskPerms) || onDisk != hash ||
+                (mode != previous_->modes.end() && onDiskPerms != mode->second)) {
+                summary_.kept.push_back(rel);
+                continue;
+            }
+            if (!fs::remove(path, ec)) {
+                std::ostringstream os;
+                os << "Failed to remove " << path << ": " << ec.message();
+                error = os.str();
+                return false;
+            }
+            ++summary_.removed;
+            // Drop directories the removal left empty.
+            for (fs::path dir = path.parent_path();
+                 dir != targetRoot_ && fs::is_empty(dir, ec) && !ec;
+                 dir = dir.parent_path()) {
+                fs::remove(dir, ec);
+            }
+        }
+    }
+
+    std::sort(summary_.kept.begin(), summary_.kept.end());
+    record.files = std::move(keptHashes_);
+    record.modes = std::move(keptModes_);
+    keptHashes_.clear();
+    keptModes_.clear();
+    for (const auto& [rel, output] : files_) {
+        record.files.emplace(rel, HashText(output.hash).view());
+        record.modes.emplace(rel, output.perms);
+    }
+    files_.clear();
+    if (summary) {
+        *summary = std::move(summary_);
+    }
+    summary_ = {};
+    return true;
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,227 @@
+// src/core/ignore_matcher.cpp
+#include "cpp_hub/ignore_matcher.hpp"
+#include "cpp_hub/template_manifest.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+bool has_wildcards(std::string_view glob) {
+    return glob.find_first_of("*?[\\") != std::string_view::npos;
+}
+
+// Match c against the class starting at glob[0] == '['. Sets `length` to
+// the size of the class, or returns false with length 0 if it is not
+// terminated (the '[' is then an ordinary character).
+bool match_class(std::string_view glob, char c, std::size_t& length) {
+    std::size_t i = 1;
+    const bool negated = i < glob.size() && (glob[i] == '!' || glob[i] == '^');
+    if (negated) {
+        ++i;
+    }
+    const std::size_t start = i; // a ']' right here is a member, not the end
+    bool matched = false;
+    while (i < glob.size() && (glob[i] != ']' || i == start)) {
+        char lo = glob[i];
+        if (lo == '\\' && i + 1 < glob.size()) {
+            lo = glob[++i];
+        }
+        char hi = lo;
+        if (i + 2 < glob.size() && glob[i + 1] == '-' && glob[i + 2] != ']') {
+            hi = glob[i + 2];
+            i += 2;
+        }
+        matched = matched || (lo <= c && c <= hi);
+        ++i;
+    }
+    if (i >= glob.size()) {
+        length = 0;
+        return false;
+    }
+    length = i + 1;
+    return matched != negated && c != '/';
+}
+
+bool match_from(std::string_view glob, std::string_view text, bool componentStart) {
+    while (!glob.empty()) {
+        if (componentStart && glob.substr(0, 2) == "**" &&
+            (glob.size() == 2 || glob[2] == '/')) {
+            if (glob.size() == 2) {
+                return true; // trailing "**": everything below
+            }
+            glob.remove_prefix(3);
+            // "**/" stands for zero or more whole components.
+            for (;;) {
+                if (match_from(glob, text, true)) {
+                    return true;
+                }
+                const std::size_t slash = text.find('/');
+                if (slash == std::string_view::npos) {
+                    return false;
+                }
+                text.remove_prefix(slash + 1);
+            }
+        }
+
+        char c = glob[0];
+        if (c == '*') {
+            while (!glob.empty() && glob[0] == '*') {
+                glob.remove_prefix(1);
+            }
+            for (std::size_t i = 0;; ++i) {
+                if (match_from(glob, text.substr(i), false)) {
+                    return true;
+                }
+                if (i >= text.size() || text[i] == '/') {
+                    return false;
+                }
+            }
+        }
+        if (text.empty()) {
+            return false;
+        }
+        std::size_t consumed = 0;
+        bool matched = false;
+        if (c == '[') {
+            matched = match_class(glob, text[0], consumed);
+        }
+        if (consumed == 0) {
+            consumed = 1;
+            if (c == '?') {
+                matched = text[0] != '/';
+            } else {
+                if (c == '\\' && glob.size() > 1) {
+                    c = glob[1];
+                    consumed = 2;
+                }
+                matched = c == text[0];
+            }
+        }
+        if (!matched) {
+            return false;
+        }
+        componentStart = text[0] == '/';
+        glob.remove_prefix(consumed);
+        text.remove_prefix(1);
+    }
+    return text.empty();
+}
+
+} // namespace
+
+bool glob_match(std::string_view glob, std::string_view text) {
+    return match_from(glob, text, true);
+}
+
+IgnoreMatcher::IgnoreMatcher(const std::vector<std::string>& patterns) {
+    for (std::string line : patterns) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        while (!line.empty() && line.back() == ' ' &&
+               (line.size() < 2 || line[line.size() - 2] != '\\')) {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        Rule rule;
+        if (line[0] == '!') {
+            rule.negated = true;
+            line.erase(0, 1);
+        } else if (line[0] == '\\' && line.size() > 1 && (line[1] == '!' || line[1] == '#')) {
+            line.erase(0, 1);
+        }
+        while (!line.empty() && line.back() == '/') {
+            rule.directoryOnly = true;
+            line.pop_back();
+        }
+        rule.anchored = line.find('/') != std::string::npos;
+        if (rule.anchored && line[0] == '/') {
+            line.erase(0, 1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        rule.glob = std::move(line);
+        rules_.push_back(std::move(rule));
+    }
+
+    // The maps keep views into rules_, which no longer changes.
+    for (std::uint32_t i = 0; i < rules_.size(); ++i) {
+        const Rule& rule = rules_[i];
+        if (has_wildcards(rule.glob)) {
+            globs_.push_back(i);
+        } else {
+            (rule.anchored ? paths_ : names_)[rule.glob].push_back(i);
+        }
+    }
+}
+
+void IgnoreMatcher::consider(const std::vector<std::uint32_t>* candidates, bool directory,
+                             std::int64_t& best) const {
+    if (!candidates) {
+        return;
+    }
+    for (const std::uint32_t i : *candidates) {
+        if ((directory || !rules_[i].directoryOnly) && static_cast<std::int64_t>(i) > best) {
+            best = i;
+        }
+    }
+}
+
+bool IgnoreMatcher::ignored(std::string_view relPath, bool directory) const {
+    if (rules_.empty()) {
+        return false;
+    }
+    const std::size_t slash = relPath.rfind('/');
+    const std::string_view name =
+        slash == std::string_view::npos ? relPath : relPath.substr(slash + 1);
+
+    std::int64_t best = -1;
+    if (!names_.empty()) {
+        const auto it = names_.find(name);
+        consider(it == names_.end() ? nullptr : &it->second, directory, best);
+    }
+    if (!paths_.empty()) {
+        const auto it = paths_.find(relPath);
+        consider(it == paths_.end() ? nullptr : &it->second, directory, best);
+    }
+    for (auto it = globs_.rbegin(); it != globs_.rend() && static_cast<std::int64_t>(*it) > best;
+         ++it) {
+        const Rule& rule = rules_[*it];
+        if ((directory || !rule.directoryOnly) &&
+            glob_match(rule.glob, rule.anchored ? relPath : name)) {
+            best = *it;
+            break;
+        }
+    }
+    return best >= 0 && !rules_[static_cast<std::size_t>(best)].negated;
+}
+
+std::vector<std::string> load_ignore_patterns(const fs::path& templateRoot,
+                                              const TemplateManifest& manifest) {
+    std::vector<std::string> patterns = manifest.ignore;
+    const fs::path file = templateRoot / fs::path(kIgnoreFileName);
+    std::error_code ec;
+    if (!fs::exists(file, ec)) {
+        return patterns;
+    }
+    std::ifstream in(file);
+    if (!in) {
+        throw std::runtime_error("Failed to read " + file.string());
+    }
+    for (std::string line; std::getline(in, line);) {
+        patterns.push_back(std::move(line));
+    }
+    return patterns;
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,792 @@
+// src/core/index_snapshot.cpp
+#include "cpp_hub/index_snapshot.hpp"
+#include "cpp_hub/util/binary_io.hpp"
+#include "cpp_hub/util/fs.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+#include "cpp_hub/util/string_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+namespace cpp_hub {
+
+namespace {
+
+// Bump the trailing digit whenever the layout below changes.
+constexpr std::string_view kMagic = "CPPHUBR7";
+
+constexpr std::size_t kMaxShardPrefixLength = 16;
+
+bool better_hit(const SearchHit& a, const SearchHit& b) {
+    return a.score != b.score ? a.score > b.score : a.ordinal < b.ordinal;
+}
+
+// Strings of the snapshot, each stored once: tags and build systems repeat
+// across most templates.
+class StringTable {
+public:
+    PackedString add(std::string_view s) {
+        const auto it = index_.find(std::string(s));
+        if (it != index_.end()) {
+            return it->second;
+        }
+        if (data_.size() + s.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("Registry index is too large.");
+        }
+        const PackedString packed{static_cast<std::uint32_t>(data_.size()),
+                                  static_cast<std::uint32_t>(s.size())};
+        data_.append(s);
+        index_.emplace(std::string(s), packed);
+        return packed;
+    }
+
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+    std::unordered_map<std::string, PackedString> index_;
+};
+
+// Distinct tags and build systems, numbered in order of first use.
+class SymbolTable {
+public:
+    explicit SymbolTable(StringTable& strings) : strings_(strings) {}
+
+    std::uint32_t add(const std::string& s) {
+        const auto [it, inserted] =
+            ids_.emplace(s, static_cast<std::uint32_t>(symbols_.size()));
+        if (inserted) {
+            symbols_.push_back(strings_.add(s));
+        }
+        return it->second;
+    }
+
+    const std::vector<PackedString>& symbols() const { return symbols_; }
+
+private:
+    StringTable& strings_;
+    std::vector<PackedString> symbols_;
+    std::unordered_map<std::string, std::uint32_t> ids_;
+};
+
+// Builds the templates of an index file as the parser reports tokens, so
+// no DOM of the (possibly large) index is ever held. Values the index does
+// not use are skipped without being stored.
+class IndexSaxHandler : public json::json_sax_t {
+public:
+    IndexSaxHandler(std::string_view shard, std::size_t shardPrefixLength)
+        : shard_(shard), shardPrefixLength_(shardPrefixLength) {}
+
+    std::string registryName;
+    std::vector<TemplateInfo> templates;
+    bool sharded = false;      // has a "shards" object
+    bool hasTemplates = false; // has a "templates" object
+    std::size_t prefixLength = 0;
+    std::string error; // set when the JSON itself is malformed
+
+    bool null() override { return scalar(nullptr); }
+    bool boolean(bool) override { return scalar(nullptr); }
+    bool number_integer(number_integer_t) override { return scalar(nullptr); }
+    bool number_float(number_float_t, const string_t&) override { return scalar(nullptr); }
+    bool binary(binary_t&) override { return scalar(nullptr); }
+    bool string(string_t& val) override { return scalar(&val); }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        if (skipDepth_ == 0 && next_ == Value::PrefixLength) {
+            next_ = Value::Skip;
+            if (val == 0 || val > kMaxShardPrefixLength) {
+                reject(Value::PrefixLength);
+            }
+            prefixLength = static_cast<std::size_t>(val);
+            return true;
+        }
+        return scalar(nullptr);
+    }
+
+    bool start_object(std::size_t) override {
+        if (skipDepth_ > 0) {
+            ++skipDepth_;
+            return true;
+        }
+        if (contexts_.empty()) {
+            contexts_.push_back(Context::Root);
+            return true;
+        }
+        const Value next = std::exchange(next_, Value::Skip);
+        switch (next) {
+        case Value::Shards:
+            sharded = true;
+            contexts_.push_back(Context::Shards);
+            break;
+        case Value::Templates:
+            hasTemplates = true;
+            contexts_.push_back(Context::Templates);
+            break;
+        case Value::Template:
+            current_ = TemplateInfo{};
+            current_.id = key_;
+            contexts_.push_back(Context::Template);
+            break;
+        default:
+            reject(next);
+            skipDepth_ = 1;
+            break;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (skipDepth_ > 0) {
+            --skipDepth_;
+            return true;
+        }
+        const Context context = contexts_.back();
+        contexts_.pop_back();
+        if (context == Context::Shards && prefixLength == 0) {
+            reject(Value::Shards);
+        } else if (context == Context::Template) {
+            finish_template();
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (skipDepth_ > 0) {
+            ++skipDepth_;
+            return true;
+        }
+        const Value next = std::exchange(next_, Value::Skip);
+        if (!contexts_.empty() && next == Value::Tags) {
+            contexts_.push_back(Context::Tags);
+            return true;
+        }
+        reject(next);
+        skipDepth_ = 1;
+        return true;
+    }
+
+    bool end_array() override {
+        if (skipDepth_ > 0) {
+            --skipDepth_;
+        } else {
+            contexts_.pop_back();
+        }
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        if (skipDepth_ > 0) {
+            return true;
+        }
+        next_ = Value::Skip;
+        switch (contexts_.back()) {
+        case Context::Root:
+            if (val == "registry_name") {
+                next_ = Value::RegistryName;
+            } else if (val == "shards") {
+                next_ = Value::Shards;
+            } else if (val == "templates") {
+                next_ = Value::Templates;
+            }
+            break;
+        case Context::Shards:
+            if (val == "prefix_length") {
+                next_ = Value::PrefixLength;
+            }
+            break;
+        case Context::Templates:
+            key_ = val;
+            next_ = Value::Template;
+            break;
+        case Context::Template:
+            field_ = val;
+            if (val == "id") {
+                next_ = Value::Id;
+            } else if (val == "name") {
+                next_ = Value::Name;
+            } else if (val == "description") {
+                next_ = Value::Description;
+            } else if (val == "url") {
+                next_ = Value::Url;
+            } else if (val == "build_system") {
+                next_ = Value::BuildSystem;
+            } else if (val == "revision") {
+                next_ = Value::Revision;
+            } else if (val == "tags") {
+                next_ = Value::Tags;
+            }
+            break;
+        case Context::Tags:
+            break;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+                     const nlohmann::detail::exception& ex) override {
+        error = ex.what();
+        return false;
+    }
+
+private:
+    enum class Context { Root, Shards, Templates, Template, Tags };
+    // What the next value is, going by the key before it.
+    enum class Value {
+        Skip,
+        RegistryName,
+        Shards,
+        PrefixLength,
+        Templates,
+        Template,
+        Id,
+        Name,
+        Description,
+        Url,
+        BuildSystem,
+        Revision,
+        Tags,
+    };
+
+    bool scalar(string_t* s) {
+        if (skipDepth_ > 0) {
+            return true;
+        }
+        if (!contexts_.empty() && contexts_.back() == Context::Tags) {
+            if (s) {
+                current_.tags.push_back(std::move(*s));
+            }
+            return true;
+        }
+        const Value next = std::exchange(next_, Value::Skip);
+        std::string* target = string_field(next);
+        if (target && s) {
+            *target = std::move(*s);
+        } else {
+            reject(next);
+        }
+        return true;
+    }
+
+    std::string* string_field(Value v) {
+        switch (v) {
+        case Value::RegistryName: return &registryName;
+        case Value::Id: return &current_.id;
+        case Value::Name: return &current_.name;
+        case Value::Description: return &current_.description;
+        case Value::Url: return &current_.url;
+        case Value::BuildSystem: return &current_.buildSystem;
+        case Value::Revision: return &current_.revision;
+        default: return nullptr;
+        }
+    }
+
+    // Report a value of the wrong type for what v expects. A "templates"
+    // that is not an object is reported once parsing ends; "tags" that are
+    // not an array and values of unknown keys are ignored.
+    void reject(Value v) const {
+        switch (v) {
+        case Value::RegistryName:
+            throw std::runtime_error("Registry index.json has a non-string 'registry_name'.");
+        case Value::Shards:
+        case Value::PrefixLength:
+            throw std::runtime_error("Registry index.json has an invalid 'shards' object.");
+        case Value::Template:
+            throw std::runtime_error("Registry template '" + key_ + "' is not an object.");
+        case Value::Id:
+        case Value::Name:
+        case Value::Description:
+        case Value::Url:
+        case Value::BuildSystem:
+        case Value::Revision:
+            throw std::runtime_error("Registry template '" + key_ + "' has a non-string '" +
+                                     field_ + "'.");
+        default:
+            break;
+        }
+    }
+
+    void finish_template() {
+        if (current_.id.empty() || current_.url.empty()) {
+            std::cerr << "Skipping template '" << key_ << "' due to missing id or url.\n";
+            return;
+        }
+        if (!shard_.empty() &&
+            std::string_view(current_.id).substr(0, shardPrefixLength_) != shard_) {
+            std::cerr << "Skipping template '" << current_.id
+                      << "' which does not belong in shard '" << shard_ << "'.\n";
+            return;
+        }
+        templates.push_back(std::move(current_));
+    }
+
+    std::string_view shard_;
+    std::size_t shardPrefixLength_;
+
+    std::vector<Context> contexts_; // enclosing objects and arrays, unless skipped
+    Value next_ = Value::Skip;
+    std::size_t skipDepth_ = 0; // nesting depth inside a skipped value
+    std::string key_;           // of the current template
+    std::string field_;         // last key in the current template
+    TemplateInfo current_;
+};
+
+// Parse an index file into its templates sorted by id; of several with the
+// same id, the first listed wins. The index.json of a sharded registry
+// names no templates but the shard prefix length; a shard only lists
+// templates.
+std::vector<TemplateInfo> parse_index(const fs::path& indexPath,
+                                      std::string_view shard,
+                                      std::size_t shardPrefixLength,
+                                      std::string& registryName,
+                                      std::size_t& prefixLength) {
+    util::MappedFile file;
+    std::error_code ec;
+    if (!file.open(indexPath, ec)) {
+        throw std::runtime_error("Could not open registry index: " + indexPath.string());
+    }
+
+    IndexSaxHandler handler(shard, shardPrefixLength);
+    const std::string_view text = file.view();
+    if (!json::sax_parse(text.begin(), text.end(), &handler)) {
+        throw std::runtime_error("Failed to parse registry index.json: " + handler.error);
+    }
+
+    registryName = std::move(handler.registryName);
+    prefixLength = handler.prefixLength;
+    if (handler.sharded) {
+        return {};
+    }
+    if (!handler.hasTemplates) {
+        throw std::runtime_error("Registry index.json missing 'templates' object.");
+    }
+
+    std::vector<TemplateInfo> templates = std::move(handler.templates);
+    std::stable_sort(templates.begin(), templates.end(),
+                     [](const TemplateInfo& a, const TemplateInfo& b) { return a.id < b.id; });
+    templates.erase(std::unique(templates.begin(), templates.end(),
+                                [](const TemplateInfo& a, const TemplateInfo& b) {
+                                    return a.id == b.id;
+                                }),
+                    templates.end());
+    return templates;
+}
+
+bool matches_query(const TemplateView& t, std::string_view query) {
+    if (util::icontains(t.id(), query) ||
+        util::icontains(t.name(), query) ||
+        util::icontains(t.description(), query)) {
+        return true;
+    }
+    for (std::size_t k = 0; k < t.tag_count(); ++k) {
+        if (util::icontains(t.tag(k), query)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Case-insensitive count of the non-overlapping occurrences of a
+// lowercased term in text.
+std::size_t count_occurrences(std::string_view text, std::string_view term) {
+    std::size_t count = 0;
+    for (auto it = text.begin();;) {
+        it = std::search(it, text.end(), term.begin(), term.end(), [](char a, char b) {
+            return (a >= 'A' && a <= 'Z' ? static_cast<char>(a - 'A' + 'a') : a) == b;
+        });
+        if (it == text.end()) {
+            return count;
+        }
+        ++count;
+        it += static_cast<std::ptrdiff_t>(term.size());
+    }
+}
+
+// The distinct words of a lowercased query.
+std::vector<std::string_view> query_words(std::string_view query) {
+    std::vector<std::string_view> words;
+    for (std::size_t pos = 0; pos < query.size();) {
+        const std::size_t end = std::min(query.find(' ', pos), query.size());
+        const std::string_view word = query.substr(pos, end - pos);
+        pos = end + 1;
+        if (!word.empty() && std::find(words.begin(), words.end(), word) == words.end()) {
+            words.push_back(word);
+        }
+    }
+    return words;
+}
+
+// BM25F relevance: the occurrences of each query word are weighted by
+// field, normalized by the field's length relative to its average, then
+// saturated and scaled by the word's inverse document frequency. Document
+// frequencies come from the trigram index, so they are upper bounds, and
+// words shorter than a trigram count as occurring everywhere.
+class SearchScorer {
+public:
+    SearchScorer(const SearchStats& stats, std::string_view query) : query_(query) {
+        const double n = stats.templates;
+        for (std::size_t f = 0; f < kSearchFieldCount; ++f) {
+            averages_[f] = n > 0 ? stats.lengths[f] / n : 0;
+        }
+        const std::vector<std::string_view> words = query_words(query);
+        for (std::size_t w = 0; w < words.size(); ++w) {
+            const double df = w < stats.frequencies.size() ? stats.frequencies[w] : n;
+            const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+            terms_.push_back({words[w], idf});
+            idfSum_ += idf;
+        }
+    }
+
+    double score(const TemplateView& t) const {
+        const std::string_view fields[] = {t.id(), t.name(), t.description()};
+        double norms[kSearchFieldCount];
+        for (std::size_t f = 0; f < kSearchFieldCount; ++f) {
+            const double length = f == static_cast<std::size_t>(SearchField::Tag)
+                ? static_cast<double>(t.tag_count())
+                : static_cast<double>(fields[f].size());
+            const double average = averages_[f];
+            norms[f] = average > 0 ? 1 - kB + kB * length / average : 1;
+        }
+
+        double score = 0;
+        for (const Term& term : terms_) {
+            double tf = 0;
+            for (std::size_t f = 0; f < 3; ++f) {
+                tf += kFieldWeights[f] * count_occurrences(fields[f], term.text) / norms[f];
+            }
+            std::size_t tagged = 0;
+            for (std::size_t k = 0; k < t.tag_count(); ++k) {
+                tagged += count_occurrences(t.tag(k), term.text) > 0 ? 1 : 0;
+            }
+            tf += kFieldWeights[3] * tagged / norms[3];
+            score += term.idf * tf * (kK1 + 1) / (tf + kK1);
+        }
+
+        double bonus = 0;
+        for (std::size_t f = 0; f < 3; ++f) {
+            bonus += util::iequals(fields[f], query_) ? kExactBonus[f] : 0;
+        }
+        for (std::size_t k = 0; k < t.tag_count(); ++k) {
+            if (util::iequals(t.tag(k), query_)) {
+                bonus += kExactBonus[3];
+                break;
+            }
+        }
+        return score + bonus * idfSum_;
+    }
+
+private:
+    static constexpr double kK1 = 1.2;
+    static constexpr double kB = 0.75;
+    // Indexed by SearchField: id, name, description, tag.
+    static constexpr double kFieldWeights[kSearchFieldCount] = {3.0, 2.0, 1.0, 2.0};
+    static constexpr double kExactBonus[kSearchFieldCount] = {4.0, 2.0, 1.0, 1.0};
+
+    struct Term {
+        std::string_view text;
+        double idf;
+    };
+
+    std::string_view query_;
+    double averages_[kSearchFieldCount] = {};
+    std::vector<Term> terms_;
+    double idfSum_ = 0;
+};
+
+} // namespace
+
+void rank_hits(std::vector<SearchHit>& hits, std::size_t limit) {
+    if (limit != 0 && hits.size() > limit) {
+        std::partial_sort(hits.begin(), hits.begin() + static_cast<std::ptrdiff_t>(limit),
+                          hits.end(), better_hit);
+        hits.resize(limit);
+    } else {
+        std::sort(hits.begin(), hits.end(), better_hit);
+    }
+}
+
+std::unique_ptr<IndexSnapshot> IndexSnapshot::load_or_build(
+    const fs::path& indexFile,
+    const fs::path& snapshotFile,
+    std::string_view shard,
+    std::size_t prefixLength) {
+
+    std::error_code ec;
+    const std::uint64_t size = fs::file_size(indexFile, ec);
+    const fs::file_time_type mtime =
+        ec ? fs::file_time_type{} : fs::last_write_time(indexFile, ec);
+    if (ec) {
+        throw std::runtime_error("Could not open registry index: " + indexFile.string());
+    }
+    const IndexStamp stamp{size, static_cast<std::int64_t>(mtime.time_since_epoch().count()),
+                           std::string(shard), static_cast<std::uint32_t>(prefixLength)};
+
+    std::unique_ptr<IndexSnapshot> snapshot(new IndexSnapshot());
+    if (snapshot->file_.open(snapshotFile, ec)) {
+        try {
+            if (snapshot->decode(snapshot->file_.view()) == stamp) {
+                return snapshot;
+            }
+        } catch (const std::exception&) {
+            // Corrupt or from an older cpp-hub; rebuild below.
+        }
+        snapshot.reset(new IndexSnapshot());
+    }
+
+    snapshot->owned_ = build(indexFile, stamp);
+    snapshot->decode(snapshot->owned_);
+
+    if (!util::write_file_atomically(snapshotFile, snapshot->owned_, ec)) {
+        std::cerr << "Warning: could not write registry snapshot " << snapshotFile << "\n";
+    }
+    return snapshot;
+}
+
+std::string IndexSnapshot::build(const fs::path& indexFile, const IndexStamp& stamp) {
+    std::string registryName;
+    std::size_t prefixLength = 0;
+    const std::vector<TemplateInfo> templates = parse_index(
+        indexFile, stamp.shard, stamp.shardPrefixLength, registryName, prefixLength);
+
+    StringTable strings;
+    SymbolTable symbols(strings);
+    TrigramIndex::Builder search;
+    TagIndex::Builder tagIndex;
+    std::string folded;
+    std::vector<PackedTemplate> packed;
+    std::vector<std::uint32_t> tags;
+    packed.reserve(templates.size());
+    for (const auto& info : templates) {
+        PackedTemplate t{};
+        t.id = strings.add(info.id);
+        t.name = strings.add(info.name);
+        t.description = strings.add(info.description);
+        t.url = strings.add(info.url);
+        t.revision = strings.add(info.revision);
+        t.buildSystem = symbols.add(info.buildSystem);
+        t.firstTag = static_cast<std::uint32_t>(tags.size());
+        t.tagCount = static_cast<std::uint32_t>(info.tags.size());
+        for (const auto& tag : info.tags) {
+            tags.push_back(symbols.add(tag));
+            tagIndex.add(tag, static_cast<std::uint32_t>(packed.size()));
+        }
+        packed.push_back(t);
+
+        const std::pair<SearchField, const std::string*> fields[] = {
+            {SearchField::Id, &info.id},
+            {SearchField::Name, &info.name},
+            {SearchField::Description, &info.description},
+        };
+        for (const auto& [field, text] : fields) {
+            folded = *text;
+            fold_case(folded);
+            search.add_text(field, folded);
+        }
+        for (const auto& tag : info.tags) {
+            folded = tag;
+            fold_case(folded);
+            search.add_text(SearchField::Tag, folded);
+        }
+        search.end_template();
+    }
+
+    util::BinaryWriter w;
+    w.put_bytes(kMagic.data(), kMagic.size());
+    w.put(stamp.size);
+    w.put(stamp.mtime);
+    w.put_string(stamp.shard);
+    w.put(stamp.shardPrefixLength);
+    w.put_string(registryName);
+    w.put(static_cast<std::uint32_t>(prefixLength));
+    w.put(static_cast<std::uint32_t>(packed.size()));
+    w.put(static_cast<std::uint32_t>(symbols.symbols().size()));
+    w.put(static_cast<std::uint32_t>(tags.size()));
+    w.put(static_cast<std::uint64_t>(strings.data().size()));
+    w.align(alignof(PackedTemplate));
+    w.put_bytes(packed.data(), packed.size() * sizeof(PackedTemplate));
+    w.put_bytes(symbols.symbols().data(), symbols.symbols().size() * sizeof(PackedString));
+    w.put_bytes(tags.data(), tags.size() * sizeof(std::uint32_t));
+    w.put_bytes(strings.data().data(), strings.data().size());
+    search.write(w);
+    tagIndex.write(w);
+
+    return w.take();
+}
+
+std::optional<TemplateView> IndexSnapshot::find(std::string_view id) const {
+    auto it = std::lower_bound(templates_.begin(), templates_.end(), id,
+                               [this](const PackedTemplate& t, std::string_view key) {
+                                   return strings_.substr(t.id.offset, t.id.length) < key;
+                               });
+    if (it == templates_.end() || strings_.substr(it->id.offset, it->id.length) != id) {
+        return std::nullopt;
+    }
+    return TemplateView(*it, symbols_, tags_, strings_);
+}
+
+void IndexSnapshot::add_search_stats(std::string_view query, SearchStats& stats) const {
+    std::string folded(query);
+    fold_case(folded);
+    const std::vector<std::string_view> words = query_words(folded);
+    const double n = static_cast<double>(size());
+
+    stats.templates += n;
+    for (std::size_t f = 0; f < kSearchFieldCount; ++f) {
+        stats.lengths[f] += search_.average_length(static_cast<SearchField>(f)) * n;
+    }
+    stats.frequencies.resize(words.size(), 0.0);
+    std::vector<std::uint32_t> candidates;
+    for (std::size_t w = 0; w < words.size(); ++w) {
+        stats.frequencies[w] += search_.candidates(words[w], candidates)
+            ? static_cast<double>(candidates.size())
+            : n;
+    }
+}
+
+std::vector<SearchHit> IndexSnapshot::search(
+    std::string_view query,
+    std::size_t limit,
+    const std::function<bool(std::size_t)>& accept,
+    const SearchStats* stats) const {
+    SearchStats own;
+    if (!stats) {
+        add_search_stats(query, own);
+        stats = &own;
+    }
+    std::string folded(query);
+    fold_case(folded);
+    const SearchScorer scorer(*stats, folded);
+
+    // With a limit, hits is a heap whose front is the worst hit kept.
+    std::vector<SearchHit> hits;
+    auto offer = [&](std::size_t i) {
+        const TemplateView t = at(i);
+        if ((accept && !accept(i)) || !matches_query(t, query)) {
+            return;
+        }
+        const SearchHit hit{i, scorer.score(t)};
+        if (limit == 0) {
+            hits.push_back(hit);
+        } else if (hits.size() < limit) {
+            hits.push_back(hit);
+            std::push_heap(hits.begin(), hits.end(), better_hit);
+        } else if (better_hit(hit, hits.front())) {
+            std::pop_heap(hits.begin(), hits.end(), better_hit);
+            hits.back() = hit;
+            std::push_heap(hits.begin(), hits.end(), better_hit);
+        }
+    };
+
+    std::vector<std::uint32_t> candidates;
+    if (search_.candidates(folded, candidates)) {
+        for (const std::uint32_t i : candidates) {
+            if (i < size()) {
+                offer(i);
+            }
+        }
+    } else {
+        for (std::size_t i = 0; i < size(); ++i) {
+            offer(i);
+        }
+    }
+
+    if (limit == 0) {
+        std::sort(hits.begin(), hits.end(), better_hit);
+    } else {
+        std::sort_heap(hits.begin(), hits.end(), better_hit);
+    }
+    return hits;
+}
+
+std::vector<std::size_t> IndexSnapshot::with_tags(const TagQuery& query) const {
+    TemplateSet result(size(), query.all.empty());
+    for (std::size_t i = 0; i < query.all.size(); ++i) {
+        const TemplateSet set = tagIndex_.lookup(query.all[i], size());
+        if (i == 0) {
+            result = set;
+        } else {
+            result.intersect(set);
+        }
+    }
+    if (!query.any.empty()) {
+        TemplateSet any(size());
+        for (const auto& tag : query.any) {
+            any.unite(tagIndex_.lookup(tag, size()));
+        }
+        result.intersect(any);
+    }
+    for (const auto& tag : query.none) {
+        result.subtract(tagIndex_.lookup(tag, size()));
+    }
+    return result.members();
+}
+
+IndexSnapshot::IndexStamp IndexSnapshot::decode(std::string_view data) {
+    util::BinaryReader r(data);
+    const std::string_view magic(r.get_array<char>(kMagic.size()), kMagic.size());
+    if (magic != kMagic) {
+        throw std::runtime_error("not a registry snapshot");
+    }
+
+    IndexStamp stamp{};
+    stamp.size = r.get<std::uint64_t>();
+    stamp.mtime = r.get<std::int64_t>();
+    stamp.shard = r.get_string();
+    stamp.shardPrefixLength = r.get<std::uint32_t>();
+    registryName_ = r.get_string();
+    prefixLength_ = r.get<std::uint32_t>();
+    const auto templateCount = r.get<std::uint32_t>();
+    const auto symbolCount = r.get<std::uint32_t>();
+    const auto tagCount = r.get<std::uint32_t>();
+    const auto stringBytes = r.get<std::uint64_t>();
+    r.align(alignof(PackedTemplate));
+    templates_ = {r.get_array<PackedTemplate>(templateCount), templateCount};
+    symbols_ = {r.get_array<PackedString>(symbolCount), symbolCount};
+    tags_ = {r.get_array<std::uint32_t>(tagCount), tagCount};
+    strings_ = {r.get_array<char>(stringBytes), static_cast<std::size_t>(stringBytes)};
+    search_.decode(r);
+    tagIndex_.decode(r);
+    if (!r.at_end()) {
+        throw std::runtime_error("trailing data in registry snapshot");
+    }
+
+    auto check = [&](PackedString s) {
+        if (s.offset > strings_.size() || s.length > strings_.size() - s.offset) {
+            throw std::runtime_error("registry snapshot has an invalid string");
+        }
+    };
+    for (const auto& t : templates_) {
+        check(t.id);
+        check(t.name);
+        check(t.description);
+        check(t.url);
+        check(t.revision);
+        if (t.buildSystem >= symbols_.size()) {
+            throw std::runtime_error("registry snapshot has an invalid build system");
+        }
+        if (t.firstTag > tags_.size() || t.tagCount > tags_.size() - t.firstTag) {
+            throw std::runtime_error("registry snapshot has an invalid tag list");
+        }
+    }
+    for (const auto& symbol : symbols_) {
+        check(symbol);
+    }
+    for (const std::uint32_t tag : tags_) {
+        if (tag >= symbols_.size()) {
+            throw std::runtime_error("registry snapshot has an invalid tag");
+        }
+    }
+    return stamp;
+}
+
+} // namespace cpp_hub
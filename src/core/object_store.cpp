@@ -0,0 +1,144 @@
+// src/core/object_store.cpp
+#include "cpp_hub/object_store.hpp"
+#include "cpp_hub/generation_record.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+#include "cpp_hub/util/thread_pool.hpp"
+
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+enum class Absorbed { Unchanged, Stored, Shared };
+
+// Objects live in 256 fan-out directories, named after the first two hex
+// digits of the hash: <root>/ab/<rest of hash>-<size>-<octal perms>.
+fs::path object_path(const fs::path& root, std::string_view content, fs::perms perms) {
+    const std::string hash = content_hash(content);
+    const std::string hex = hash.substr(hash.find(':') + 1);
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), "-%zu-%03o", content.size(),
+                  static_cast<unsigned>(perms & fs::perms::mask));
+    return root / hex.substr(0, 2) / (hex.substr(2) + suffix);
+}
+
+// Replace file by a hard link to object, via a temporary link and a rename
+// so the file is never missing.
+bool link_in_place(const fs::path& object, const fs::path& file) {
+    fs::path staged = file;
+    staged += ".cpp-hub-link";
+    std::error_code ec;
+    fs::remove(staged, ec);
+    fs::create_hard_link(object, staged, ec);
+    if (!ec) {
+        fs::rename(staged, file, ec);
+    }
+    if (ec) {
+        fs::remove(staged, ec);
+        return false;
+    }
+    return true;
+}
+
+Absorbed absorb_file(const fs::path& root, const fs::path& file) {
+    util::MappedFile content;
+    std::error_code ec;
+    if (!content.open(file, ec) || content.size() == 0) {
+        return Absorbed::Unchanged;
+    }
+    const fs::path object = object_path(root, content.view(), content.permissions());
+
+    fs::create_directories(object.parent_path(), ec);
+    fs::create_hard_link(file, object, ec);
+    if (!ec) {
+        return Absorbed::Stored;
+    }
+    // Most likely the object exists already, possibly as this very file.
+    if (fs::equivalent(file, object, ec) || ec) {
+        return Absorbed::Unchanged;
+    }
+    util::MappedFile stored;
+    if (!stored.open(object, ec) || stored.view() != content.view()) {
+        return Absorbed::Unchanged;
+    }
+    content.close();
+    return link_in_place(object, file) ? Absorbed::Shared : Absorbed::Unchanged;
+}
+
+} // namespace
+
+ObjectStore::ObjectStore(fs::path root)
+    : root_(std::move(root)) {}
+
+ObjectStore::AbsorbStats ObjectStore::absorb(const fs::path& tree, unsigned jobs) const {
+    std::vector<std::pair<fs::path, std::uint64_t>> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(tree, fs::directory_options::skip_permission_denied,
+                                             ec), end;
+         !ec && it != end; it.increment(ec)) {
+        const fs::file_status status = it->symlink_status(ec);
+        if (ec) {
+            break;
+        }
+        if (fs::is_directory(status) && it->path().filename() == ".git") {
+            it.disable_recursion_pending();
+        } else if (fs::is_regular_file(status)) {
+            std::error_code sizeError;
+            files.emplace_back(it->path(), it->file_size(sizeError));
+        }
+    }
+
+    std::vector<Absorbed> results(files.size(), Absorbed::Unchanged);
+    util::parallel_for(files.size(), jobs, [&](std::size_t i) {
+        results[i] = absorb_file(root_, files[i].first);
+    });
+
+    AbsorbStats stats;
+    stats.files = files.size();
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (results[i] == Absorbed::Stored) {
+            ++stats.stored;
+        } else if (results[i] == Absorbed::Shared) {
+            ++stats.shared;
+            stats.savedBytes += files[i].second;
+        }
+    }
+    return stats;
+}
+
+std::size_t ObjectStore::prune() const {
+    std::size_t removed = 0;
+    std::error_code ec;
+    for (fs::directory_iterator dir(root_, ec), end; !ec && dir != end; dir.increment(ec)) {
+        std::error_code statError;
+        if (!dir->is_directory(statError)) {
+            continue;
+        }
+        std::vector<fs::path> unused;
+        std::error_code walk;
+        for (fs::directory_iterator it(dir->path(), walk); !walk && it != end;
+             it.increment(walk)) {
+            if (it->is_regular_file(statError) && it->hard_link_count(statError) == 1) {
+                unused.push_back(it->path());
+            }
+        }
+        for (const auto& object : unused) {
+            std::error_code removeError;
+            removed += fs::remove(object, removeError) ? 1 : 0;
+        }
+        std::error_code removeError;
+        if (fs::is_empty(dir->path(), removeError)) {
+            fs::remove(dir->path(), removeError);
+        }
+    }
+    return removed;
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,663 @@
+// src/core/output_backend.cpp
+#include "cpp_hub/output_backend.hpp"
+#include "cpp_hub/util/fs.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <system_error>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// Direct descriptors and IORING_OP_MKDIRAT need a 5.15+ uapi header; this
+// flag is a macro of about that age that can be tested for.
+#ifdef IORING_SETUP_SUBMIT_ALL
+#define CPP_HUB_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef CPP_HUB_HAVE_IO_URING
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+// Format "<what> <path>" the same way the renderer streams paths.
+static std::string path_message(const char* what, const fs::path& p) {
+    std::ostringstream os;
+    os << what << " " << p;
+    return os.str();
+}
+
+namespace {
+
+class FileStream final : public OutputStream {
+public:
+    explicit FileStream(fs::path dest) : dest_(std::move(dest)) {}
+
+    bool open(fs::perms perms, std::string& error) {
+        std::error_code ec;
+        if (!file_.open(dest_, perms, ec)) {
+            error = path_message("Failed to create file", dest_) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    bool write(std::string_view data, std::string& error) override {
+        std::error_code ec;
+        if (!file_.write(data, ec)) {
+            error = path_message("Failed to write file", dest_) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    bool close(std::string& error) override {
+        std::error_code ec;
+        if (!file_.close(ec)) {
+            error = path_message("Failed to write file", dest_) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    fs::path dest_;
+    util::OutputFile file_;
+};
+
+class PosixOutput final : public OutputBackend {
+public:
+    const char* name() const override { return "posix"; }
+
+    bool create_directories(const std::vector<fs::path>& dirs, std::string& error) override {
+        std::error_code ec;
+        for (const auto& dir : dirs) {
+            if (!fs::create_directories(dir, ec) && ec) {
+                error = path_message("Failed to create directory", dir) + ": " + ec.message();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool write_file(std::size_t, const fs::path& dest, std::string& data, fs::perms perms,
+                    std::string& error) override {
+        std::error_code ec;
+        if (!util::write_file(dest, data, perms, ec)) {
+            error = path_message("Failed to create file", dest) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    bool copy_file(std::size_t, const fs::path& src, const fs::path& dest, std::string_view,
+                   fs::perms, std::string& error) override {
+        std::error_code ec;
+        if (!util::copy_file_fast(src, dest, ec)) {
+            error = path_message("Failed to create file", dest) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<OutputStream> open_stream(std::size_t, const fs::path& dest, fs::perms perms,
+                                              std::string& error) override {
+        return open_file_stream(dest, perms, error);
+    }
+
+    std::vector<OutputFailure> finish() override { return {}; }
+};
+
+#ifdef CPP_HUB_HAVE_IO_URING
+
+// Submission queue size. At most kSlots * 3 file operations plus one batch
+// of kSlots directories are in flight, which fits both this and the (twice
+// as large) completion queue.
+constexpr unsigned kQueueEntries = 256;
+// Files being written at the same time, each owning one registered file slot.
+constexpr std::size_t kSlots = 64;
+// Queued SQEs that wake the submitter even if nothing is waiting on it.
+constexpr unsigned kSubmitBatch = 48;
+// Mapped sources up to this size are copied by queueing a write of their
+// bytes; larger ones use copy_file_fast, which keeps the data in the kernel.
+constexpr std::size_t kInlineCopyLimit = 256 << 10;
+// Larger writes are done synchronously: the SQE length is 32-bit and the
+// buffer would stay pinned in memory until its write completes.
+constexpr std::size_t kMaxQueuedWrite = 64 << 20;
+// Slots keep the buffer of their last write for the next caller, unless it
+// grew larger than this.
+constexpr std::size_t kKeptBufferSize = 256 << 10;
+
+enum Op : std::uint64_t { kOpen = 0, kWrite = 1, kClose = 2, kMkdir = 3 };
+
+// Writes files with linked OPENAT -> WRITE -> CLOSE chains using direct
+// descriptors, so a file costs no system call of its own. Render threads
+// only fill in SQEs; one submitter thread, living as long as the backend,
+// submits them in batches and reaps completions. (The kernel cancels a
+// thread's requests when it exits, so render threads must not submit.)
+//
+// open() applies the umask and leaves the mode of an existing file alone,
+// and there is no io_uring chmod. So once a file completes it is chmod'ed to
+// its template mode if the umask removed some of its bits, or, when
+// overwriting, if it may have existed before. The chmods are done by the
+// submitter without holding the lock.
+class UringOutput final : public OutputBackend {
+public:
+    explicit UringOutput(bool overwrite) : overwrite_(overwrite) {}
+    UringOutput(const UringOutput&) = delete;
+    UringOutput& operator=(const UringOutput&) = delete;
+    ~UringOutput() override;
+
+    bool init();
+
+    const char* name() const override { return "io_uring"; }
+
+    bool create_directories(const std::vector<fs::path>& dirs, std::string& error) override;
+    bool write_file(std::size_t tag, const fs::path& dest, std::string& data, fs::perms perms,
+                    std::string& error) override;
+    bool copy_file(std::size_t tag, const fs::path& src, const fs::path& dest,
+                   std::string_view content, fs::perms perms, std::string& error) override;
+    std::unique_ptr<OutputStream> open_stream(std::size_t, const fs::path& dest, fs::perms perms,
+                                              std::string& error) override {
+        return open_file_stream(dest, perms, error);
+    }
+    std::vector<OutputFailure> finish() override;
+
+private:
+    struct Slot {
+        std::size_t tag = 0;
+        fs::path dest;
+        std::string data;
+        mode_t mode = 0;
+        int pending = 0; // completions still expected for this chain
+        int error = 0;
+        const char* what = nullptr;
+    };
+
+    struct PendingChmod {
+        std::size_t tag;
+        fs::path dest;
+        mode_t mode;
+    };
+
+    io_uring_sqe* next_sqe();
+    void run_submitter();
+    void reap();
+    void complete(std::uint64_t userData, int res);
+    void release_slot(std::size_t index);
+    // Block until pred() holds, making sure queued SQEs get submitted
+    // meanwhile. Throws if the ring failed.
+    template <typename Pred>
+    void wait_until(std::unique_lock<std::mutex>& lock, Pred pred);
+
+    std::mutex mutex_;
+    std::condition_variable workQueued_; // wakes the submitter
+    std::condition_variable completed_;  // wakes threads in wait_until
+    std::thread submitter_;
+    bool stopping_ = false;
+    int ringError_ = 0;  // errno of a failed io_uring_enter; the ring is unusable
+    unsigned waiters_ = 0;
+    unsigned unsubmitted_ = 0;
+    unsigned inFlight_ = 0;
+
+    int fd_ = -1;
+    bool overwrite_;
+    mode_t umask_ = 0;
+    std::vector<PendingChmod> chmods_; // for the submitter to run
+    std::size_t chmodsRunning_ = 0;
+
+    void* sqRing_ = MAP_FAILED;
+    std::size_t sqRingSize_ = 0;
+    void* cqRing_ = MAP_FAILED;
+    std::size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqesSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::vector<Slot> slots_;
+    std::vector<std::size_t> freeSlots_;
+    std::vector<int> mkdirResults_;
+    std::vector<OutputFailure> failures_;
+};
+
+int ring_setup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int ring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(
+        ::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ring_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+UringOutput::~UringOutput() {
+    if (submitter_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workQueued_.notify_one();
+        submitter_.join();
+    }
+    if (sqes_) {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool UringOutput::init() {
+    io_uring_params p{};
+    p.flags = IORING_SETUP_SUBMIT_ALL;
+    fd_ = ring_setup(kQueueEntries, &p);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            return false;
+        }
+    }
+    sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = p.sq_entries;
+    auto* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    if (sqEntries_ < kSlots * 4) {
+        return false;
+    }
+
+    // Every opcode used below must be known to this kernel.
+    std::vector<unsigned char> probeBuffer(
+        sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(probeBuffer.data());
+    if (ring_register(fd_, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;
+    }
+    for (int op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE, IORING_OP_MKDIRAT}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    // An empty (sparse) table of direct descriptors, one per slot.
+    const std::vector<int> emptyFiles(kSlots, -1);
+    if (ring_register(fd_, IORING_REGISTER_FILES, emptyFiles.data(), kSlots) < 0) {
+        return false;
+    }
+
+    slots_.resize(kSlots);
+    for (std::size_t i = kSlots; i > 0; --i) {
+        freeSlots_.push_back(i - 1);
+    }
+
+    // Reading the umask means setting it; this runs before any render
+    // thread starts, so nobody can create a file in between.
+    umask_ = ::umask(0);
+    ::umask(umask_);
+
+    submitter_ = std::thread([this] { run_submitter(); });
+    return true;
+}
+
+io_uring_sqe* UringOutput::next_sqe() {
+    // The in-flight limits above keep the queue from ever filling up.
+    const unsigned tail = *sqTail_;
+    const unsigned index = tail & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++unsubmitted_;
+    return sqe;
+}
+
+void UringOutput::run_submitter() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        workQueued_.wait(lock, [&] {
+            return stopping_ || inFlight_ > 0 || unsubmitted_ >= kSubmitBatch ||
+                   (unsubmitted_ > 0 && waiters_ > 0);
+        });
+        if (stopping_ && inFlight_ == 0 && unsubmitted_ == 0) {
+            return;
+        }
+
+        // Only whole chains are ever queued, so submitting everything queued
+        // so far never separates linked SQEs. Render threads may keep adding
+        // SQEs behind these while the lock is released.
+        const unsigned toSubmit = unsubmitted_;
+        const bool wait = inFlight_ + toSubmit > 0;
+        lock.unlock();
+        int rc;
+        do {
+            rc = ring_enter(fd_, toSubmit, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+        } while (rc < 0 && errno == EINTR);
+        const int err = errno;
+        lock.lock();
+
+        if (rc < 0) {
+            ringError_ = err;
+            completed_.notify_all();
+            return;
+        }
+        unsubmitted_ -= static_cast<unsigned>(rc);
+        inFlight_ += static_cast<unsigned>(rc);
+        reap();
+
+        if (!chmods_.empty()) {
+            std::vector<PendingChmod> chmods;
+            chmods.swap(chmods_);
+            chmodsRunning_ = chmods.size();
+            lock.unlock();
+            std::vector<OutputFailure> failed;
+            for (const auto& c : chmods) {
+                if (::chmod(c.dest.c_str(), c.mode) != 0) {
+                    failed.push_back({c.tag, path_message("Failed to create file", c.dest) +
+                                                 ": " + std::generic_category().message(errno)});
+                }
+            }
+            lock.lock();
+            chmodsRunning_ = 0;
+            for (auto& f : failed) {
+                failures_.push_back(std::move(f));
+            }
+        }
+        completed_.notify_all();
+    }
+}
+
+void UringOutput::reap() {
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        complete(cqe.user_data, cqe.res);
+        --inFlight_;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void UringOutput::complete(std::uint64_t userData, int res) {
+    const std::uint64_t op = userData & 3;
+    const std::size_t index = static_cast<std::size_t>(userData >> 2);
+    if (op == kMkdir) {
+        mkdirResults_[index] = res;
+        return;
+    }
+
+    Slot& slot = slots_[index];
+    if (slot.error == 0) {
+        if (res < 0 && res != -ECANCELED) {
+            slot.error = -res;
+            slot.what = op == kOpen ? "Failed to create file" : "Failed to write file";
+        } else if (op == kWrite && static_cast<std::size_t>(res) != slot.data.size()) {
+            slot.error = EIO;
+            slot.what = "Failed to write file";
+        }
+    }
+    if (--slot.pending == 0) {
+        release_slot(index);
+    }
+}
+
+void UringOutput::release_slot(std::size_t index) {
+    Slot& slot = slots_[index];
+    if (slot.error == 0 && (overwrite_ || (slot.mode & umask_) != 0)) {
+        chmods_.push_back({slot.tag, std::move(slot.dest), slot.mode});
+    }
+    if (slot.error != 0) {
+        failures_.push_back({slot.tag, path_message(slot.what, slot.dest) + ": " +
+                                           std::generic_category().message(slot.error)});
+    }
+    if (slot.data.capacity() > kKeptBufferSize) {
+        std::string().swap(slot.data);
+    } else {
+        slot.data.clear();
+    }
+    freeSlots_.push_back(index);
+}
+
+template <typename Pred>
+void UringOutput::wait_until(std::unique_lock<std::mutex>& lock, Pred pred) {
+    ++waiters_;
+    workQueued_.notify_one();
+    completed_.wait(lock, [&] { return ringError_ != 0 || pred(); });
+    --waiters_;
+    if (ringError_ != 0) {
+        throw std::system_error(ringError_, std::generic_category(), "io_uring_enter");
+    }
+}
+
+bool UringOutput::create_directories(const std::vector<fs::path>& dirs, std::string& error) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // A directory is only created once the batch holding its parent has
+    // completed, so batches are formed one depth at a time.
+    std::vector<std::size_t> depth(dirs.size());
+    for (std::size_t i = 0; i < dirs.size(); ++i) {
+        depth[i] = static_cast<std::size_t>(std::distance(dirs[i].begin(), dirs[i].end()));
+    }
+    std::vector<std::size_t> order(dirs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return depth[a] < depth[b]; });
+
+    for (std::size_t begin = 0; begin < order.size();) {
+        std::size_t end = begin;
+        while (end < order.size() && end - begin < kSlots &&
+               depth[order[end]] == depth[order[begin]]) {
+            ++end;
+        }
+
+        mkdirResults_.assign(end - begin, 1);
+        for (std::size_t k = begin; k < end; ++k) {
+            io_uring_sqe* sqe = next_sqe();
+            sqe->opcode = IORING_OP_MKDIRAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(dirs[order[k]].c_str());
+            sqe->len = 0777;
+            sqe->user_data = (static_cast<std::uint64_t>(k - begin) << 2) | kMkdir;
+        }
+        wait_until(lock, [&] {
+            return std::find(mkdirResults_.begin(), mkdirResults_.end(), 1) ==
+                   mkdirResults_.end();
+        });
+
+        for (std::size_t k = begin; k < end; ++k) {
+            const fs::path& dir = dirs[order[k]];
+            const int res = mkdirResults_[k - begin];
+            std::error_code ec;
+            if (res == -ENOENT) {
+                // A parent that is not in the list, e.g. from a substituted
+                // name containing a slash.
+                fs::create_directories(dir, ec);
+            } else if (res < 0 && res != -EEXIST) {
+                ec.assign(-res, std::generic_category());
+            }
+            if (ec) {
+                error = path_message("Failed to create directory", dir) + ": " + ec.message();
+                return false;
+            }
+        }
+        begin = end;
+    }
+    return true;
+}
+
+bool UringOutput::write_file(std::size_t tag, const fs::path& dest, std::string& data,
+                             fs::perms perms, std::string& error) {
+    if (data.size() > kMaxQueuedWrite) {
+        std::error_code ec;
+        if (!util::write_file(dest, data, perms, ec)) {
+            error = path_message("Failed to create file", dest) + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (freeSlots_.empty()) {
+        wait_until(lock, [&] { return !freeSlots_.empty(); });
+    }
+    const std::size_t index = freeSlots_.back();
+    freeSlots_.pop_back();
+
+    Slot& slot = slots_[index];
+    slot.tag = tag;
+    slot.dest = dest;
+    slot.data.swap(data); // hands the slot's previous buffer to the caller
+    slot.mode = static_cast<mode_t>(perms) & 07777;
+    slot.pending = 3;
+    slot.error = 0;
+    const std::uint64_t key = static_cast<std::uint64_t>(index) << 2;
+
+    io_uring_sqe* open = next_sqe();
+    open->opcode = IORING_OP_OPENAT;
+    open->flags = IOSQE_IO_LINK;
+    open->fd = AT_FDCWD;
+    open->addr = reinterpret_cast<std::uintptr_t>(slot.dest.c_str());
+    open->len = slot.mode;
+    // O_CLOEXEC is implied (and rejected) for direct descriptors.
+    open->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    open->file_index = static_cast<std::uint32_t>(index + 1);
+    open->user_data = key | kOpen;
+
+    // Hard-linked so the close runs even if the write fails.
+    io_uring_sqe* write = next_sqe();
+    write->opcode = IORING_OP_WRITE;
+    write->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    write->fd = static_cast<std::int32_t>(index);
+    write->addr = reinterpret_cast<std::uintptr_t>(slot.data.data());
+    write->len = static_cast<std::uint32_t>(slot.data.size());
+    write->off = 0;
+    write->user_data = key | kWrite;
+
+    io_uring_sqe* close = next_sqe();
+    close->opcode = IORING_OP_CLOSE;
+    close->file_index = static_cast<std::uint32_t>(index + 1);
+    close->user_data = key | kClose;
+
+    if (unsubmitted_ >= kSubmitBatch) {
+        workQueued_.notify_one();
+    }
+    return true;
+}
+
+bool UringOutput::copy_file(std::size_t tag, const fs::path& src, const fs::path& dest,
+                            std::string_view content, fs::perms perms, std::string& error) {
+    if (!content.empty() && content.size() <= kInlineCopyLimit) {
+        thread_local std::string buffer;
+        buffer.assign(content);
+        return write_file(tag, dest, buffer, perms, error);
+    }
+    std::error_code ec;
+    if (!util::copy_file_fast(src, dest, ec)) {
+        error = path_message("Failed to create file", dest) + ": " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+std::vector<OutputFailure> UringOutput::finish() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wait_until(lock, [&] {
+        return unsubmitted_ == 0 && inFlight_ == 0 && chmods_.empty() && chmodsRunning_ == 0;
+    });
+    std::vector<OutputFailure> failures;
+    failures.swap(failures_);
+    return failures;
+}
+
+#endif // CPP_HUB_HAVE_IO_URING
+
+} // namespace
+
+std::unique_ptr<OutputStream> open_file_stream(const fs::path& dest, fs::perms perms,
+                                               std::string& error) {
+    auto stream = std::make_unique<FileStream>(dest);
+    if (!stream->open(perms, error)) {
+        return nullptr;
+    }
+    return stream;
+}
+
+std::unique_ptr<OutputBackend> make_posix_output() {
+    return std::make_unique<PosixOutput>();
+}
+
+std::unique_ptr<OutputBackend> make_io_uring_output(bool overwrite) {
+#ifdef CPP_HUB_HAVE_IO_URING
+    auto output = std::make_unique<UringOutput>(overwrite);
+    if (output->init()) {
+        return output;
+    }
+#else
+    (void)overwrite;
+#endif
+    return nullptr;
+}
+
+} // namespace cpp_hub
@@ -4,47 +4,189 @@
 #include "cpp_hub/util/fs.hpp"
 #include "cpp_hub/util/process.hpp"
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
-
-#include <nlohmann/json.hpp>
+#include <system_error>
+#include <utility>
 
 namespace fs = std::filesystem;
-using nlohmann::json;
 
 namespace cpp_hub {
 
+namespace {
+
+const std::string kNoName;
+
+// Shard names are file names under index/.
+bool is_valid_shard_name(std::string_view name) {
+    return !name.empty() && name != "." && name != ".." &&
+           name.find_first_of(std::string_view("/\\\0", 3)) == std::string_view::npos;
+}
+
+fs::path snapshot_path(const fs::path& registryPath) {
+    fs::path p = registryPath;
+    p += ".snapshot";
+    return p;
+}
+
+fs::path shard_snapshot_path(const fs::path& registryPath, const std::string& shard) {
+    fs::path dir = registryPath;
+    dir += ".shards";
+    return dir / (shard + ".snapshot");
+}
+
+} // namespace
+
 Registry::Registry()
-    : registryPath_(registry_path()), loaded_(false) {}
+    : Registry(registry_path(), default_registry_url()) {}
+
+Registry::Registry(fs::path path, std::string url)
+    : registryPath_(std::move(path)), url_(std::move(url)), loaded_(false) {}
 
 const fs::path& Registry::path() const {
     return registryPath_;
 }
 
 const std::string& Registry::name() const {
-    return registryName_;
+    return root_ ? root_->registry_name() : kNoName;
+}
+
+std::size_t Registry::size() const {
+    enumerate();
+    return starts_.back();
+}
+
+TemplateView Registry::at(std::size_t i) const {
+    enumerate();
+    const std::size_t part =
+        static_cast<std::size_t>(std::upper_bound(starts_.begin(), starts_.end(), i) -
+                                 starts_.begin()) - 1;
+    return parts_[part]->at(i - starts_[part]);
+}
+
+std::optional<TemplateView> Registry::find_template(std::string_view id) const {
+    if (!root_) {
+        return std::nullopt;
+    }
+    if (!sharded()) {
+        return root_->find(id);
+    }
+    const std::string key(id.substr(0, root_->shard_prefix_length()));
+    if (!is_valid_shard_name(key)) {
+        return std::nullopt;
+    }
+    const IndexSnapshot* part = shard(key);
+    return part ? part->find(id) : std::nullopt;
+}
+
+std::vector<SearchHit> Registry::search(
+    std::string_view query,
+    std::size_t limit,
+    const std::function<bool(std::size_t)>& accept) const {
+    enumerate();
+    if (parts_.size() == 1) {
+        return parts_.front()->search(query, limit, accept);
+    }
+
+    SearchStats stats;
+    for (const IndexSnapshot* part : parts_) {
+        part->add_search_stats(query, stats);
+    }
+    std::vector<SearchHit> hits;
+    for (std::size_t p = 0; p < parts_.size(); ++p) {
+        const std::size_t start = starts_[p];
+        std::function<bool(std::size_t)> acceptPart;
+        if (accept) {
+            acceptPart = [&](std::size_t i) { return accept(start + i); };
+        }
+        for (const auto& hit : parts_[p]->search(query, limit, acceptPart, &stats)) {
+            hits.push_back({start + hit.ordinal, hit.score});
+        }
+    }
+    rank_hits(hits, limit);
+    return hits;
+}
+
+std::vector<std::size_t> Registry::with_tags(const TagQuery& query) const {
+    enumerate();
+    std::vector<std::size_t> found;
+    for (std::size_t p = 0; p < parts_.size(); ++p) {
+        for (const std::size_t i : parts_[p]->with_tags(query)) {
+            found.push_back(starts_[p] + i);
+        }
+    }
+    return found;
 }
 
-const std::map<std::string, TemplateInfo>& Registry::templates() const {
-    return templates_;
+const IndexSnapshot* Registry::shard(const std::string& key) const {
+    auto it = shards_.find(key);
+    if (it == shards_.end()) {
+        const fs::path file = registryPath_ / "index" / (key + ".json");
+        std::error_code ec;
+        std::unique_ptr<IndexSnapshot> part;
+        if (fs::exists(file, ec)) {
+            part = IndexSnapshot::load_or_build(file, shard_snapshot_path(registryPath_, key), key,
+                                                root_->shard_prefix_length());
+        }
+        it = shards_.emplace(key, std::move(part)).first;
+    }
+    return it->second.get();
 }
 
-const TemplateInfo* Registry::find_template(const std::string& id) const {
-    auto it = templates_.find(id);
-    if (it == templates_.end()) return nullptr;
-    return &it->second;
+void Registry::enumerate() const {
+    if (enumerated_) {
+        return;
+    }
+    parts_.clear();
+    starts_.assign(1, 0);
+    if (!root_) {
+        enumerated_ = true;
+        return;
+    }
+    if (!sharded()) {
+        parts_.push_back(root_.get());
+        starts_.push_back(root_->size());
+        enumerated_ = true;
+        return;
+    }
+
+    // Shard names sort like the ids in them: every id in a shard starts
+    // with its name, and a shorter name only holds the id equal to it.
+    std::vector<std::string> keys;
+    std::error_code ec;
+    for (fs::directory_iterator it(registryPath_ / "index", ec), end; !ec && it != end;
+         it.increment(ec)) {
+        const fs::path& file = it->path();
+        std::string key = file.stem().string();
+        if (file.extension() == ".json" && is_valid_shard_name(key)) {
+            keys.push_back(std::move(key));
+        }
+    }
+    if (ec) {
+        throw std::runtime_error("Could not list registry shards in " +
+                                 (registryPath_ / "index").string() + ": " + ec.message());
+    }
+    std::sort(keys.begin(), keys.end());
+
+    for (const auto& key : keys) {
+        if (const IndexSnapshot* part = shard(key)) {
+            parts_.push_back(part);
+            starts_.push_back(starts_.back() + part->size());
+        }
+    }
+    enumerated_ = true;
 }
 
 void Registry::ensure_initialized() {
     if (!fs::exists(registryPath_)) {
-        if (!util::ensure_directory(config_root())) {
-            throw std::runtime_error("Failed to create config root directory.");
+        if (!util::ensure_directory(registryPath_.parent_path())) {
+            throw std::runtime_error("Failed to create directory " +
+                                     registryPath_.parent_path().string());
         }
-        std::string cmd = "git clone \"" + default_registry_url() + "\" \"" +
-                          registryPath_.string() + "\"";
+        std::string cmd = "git clone \"" + url_ + "\" \"" + registryPath_.string() + "\"";
         if (!util::run_command(cmd)) {
-            throw std::runtime_error("Failed to clone registry from " + default_registry_url());
+            throw std::runtime_error("Failed to clone registry from " + url_);
         }
     }
     reload();
@@ -63,64 +205,15 @@ void Registry::update() {
 }
 
 void Registry::reload() {
-    templates_.clear();
+    parts_.clear();
+    starts_.clear();
+    enumerated_ = false;
+    shards_.clear();
+    root_.reset();
     loaded_ = false;
-    load_index();
+    root_ = IndexSnapshot::load_or_build(registryPath_ / "index.json",
+                                         snapshot_path(registryPath_));
     loaded_ = true;
 }
 
-void Registry::load_index() {
-    fs::path indexPath = registryPath_ / "index.json";
-    std::ifstream in(indexPath);
-    if (!in) {
-        throw std::runtime_error("Could not open registry index: " + indexPath.string());
-    }
-
-    json j;
-    try {
-        in >> j;
-    } catch (const std::exception& e) {
-        throw std::runtime_error(std::string("Failed to parse registry index.json: ") + e.what());
-    }
-
-    if (j.contains("registry_name")) {
-        registryName_ = j["registry_name"].get<std::string>();
-    } else {
-        registryName_.clear();
-    }
-
-    if (!j.contains("templates") || !j["templates"].is_object()) {
-        throw std::runtime_error("Registry index.json missing 'templates' object.");
-    }
-
-    auto tmplObj = j["templates"];
-    for (auto it = tmplObj.begin(); it != tmplObj.end(); ++it) {
-        TemplateInfo info;
-        const std::string key = it.key();
-        const json& value = it.value();
-
-        info.id = value.value("id", key);
-        info.name = value.value("name", std::string{});
-        info.description = value.value("description", std::string{});
-        info.url = value.value("url", std::string{});
-        info.buildSystem = value.value("build_system", std::string{});
-
-        if (value.contains("tags") && value["tags"].is_array()) {
-            for (const auto& t : value["tags"]) {
-                if (t.is_string()) {
-                    info.tags.push_back(t.get<std::string>());
-                }
-            }
-        }
-
-        if (info.id.empty() || info.url.empty()) {
-            std::cerr << "Skipping template '" << key
-                      << "' due to missing id or url.\n";
-            continue;
-        }
-
-        templates_.emplace(info.id, std::move(info));
-    }
-}
-
-} // namespace cpp_hub
\ No newline at end of file
+} // namespace cpp_hub
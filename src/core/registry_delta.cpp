@@ -0,0 +1,179 @@
+// src/core/registry_delta.cpp
+#include "cpp_hub/registry_delta.hpp"
+#include "cpp_hub/util/process.hpp"
+#include "cpp_hub/util/thread_pool.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+// Clones are fetched over the network, so a few at a time is enough.
+constexpr std::size_t kMaxConcurrentRefreshes = 8;
+
+// Ids name directories under the cache root; only touch those that are a
+// single, non-hidden path component.
+bool is_cacheable_id(const std::string& id) {
+    return !id.empty() && id[0] != '.' && id.find_first_of("/\\") == std::string::npos;
+}
+
+enum class Action { Evict, Reclone, Pull };
+enum class Outcome { Evicted, Recloned, Pulled, Failed };
+
+struct CacheWork {
+    Action action;
+    std::string id;
+    std::string url;
+};
+
+void drop_compiled(const fs::path& compiledRoot, const std::string& id) {
+    std::error_code ec;
+    fs::remove(compiledRoot / (id + ".hubc"), ec);
+}
+
+Outcome refresh_one(const CacheWork& work, const fs::path& cacheRoot,
+                    const fs::path& compiledRoot) {
+    const fs::path clone = cacheRoot / work.id;
+    std::error_code ec;
+    switch (work.action) {
+    case Action::Evict:
+        fs::remove_all(clone, ec);
+        if (ec) {
+            return Outcome::Failed;
+        }
+        drop_compiled(compiledRoot, work.id);
+        return Outcome::Evicted;
+
+    case Action::Reclone: {
+        // Clone beside the old copy and swap it in only once complete, so a
+        // failed fetch leaves the cache as it was.
+        const fs::path fresh = cacheRoot / ("." + work.id + ".refresh");
+        fs::remove_all(fresh, ec);
+        const std::string cmd = "git clone \"" + work.url + "\" \"" + fresh.string() + "\"";
+        if (!util::run_command(cmd)) {
+            fs::remove_all(fresh, ec);
+            return Outcome::Failed;
+        }
+        fs::remove_all(clone, ec);
+        if (!ec) {
+            fs::rename(fresh, clone, ec);
+        }
+        if (ec) {
+            return Outcome::Failed;
+        }
+        drop_compiled(compiledRoot, work.id);
+        return Outcome::Recloned;
+    }
+
+    case Action::Pull: {
+        const std::string cmd = "git -C \"" + clone.string() + "\" pull --ff-only";
+        return util::run_command(cmd) ? Outcome::Pulled : Outcome::Failed;
+    }
+    }
+    return Outcome::Failed;
+}
+
+} // namespace
+
+std::vector<TemplateSource> template_sources(const Registry& registry) {
+    std::vector<TemplateSource> sources;
+    sources.reserve(registry.size());
+    for (std::size_t i = 0; i < registry.size(); ++i) {
+        const TemplateView t = registry.at(i);
+        sources.push_back({std::string(t.id()), std::string(t.url()), std::string(t.revision())});
+    }
+    return sources;
+}
+
+std::vector<TemplateSource> merge_template_sources(
+    const std::vector<std::vector<TemplateSource>>& registries) {
+    std::vector<TemplateSource> merged;
+    for (const auto& sources : registries) {
+        merged.insert(merged.end(), sources.begin(), sources.end());
+    }
+    std::stable_sort(merged.begin(), merged.end(),
+                     [](const TemplateSource& a, const TemplateSource& b) { return a.id < b.id; });
+    merged.erase(std::unique(merged.begin(), merged.end(),
+                             [](const TemplateSource& a, const TemplateSource& b) {
+                                 return a.id == b.id;
+                             }),
+                 merged.end());
+    return merged;
+}
+
+RegistryDelta diff_template_sources(const std::vector<TemplateSource>& before,
+                                    const std::vector<TemplateSource>& after) {
+    RegistryDelta delta;
+    auto b = before.begin();
+    auto a = after.begin();
+    while (b != before.end() || a != after.end()) {
+        if (a == after.end() || (b != before.end() && b->id < a->id)) {
+            delta.removed.push_back(b->id);
+            ++b;
+        } else if (b == before.end() || a->id < b->id) {
+            delta.added.push_back(*a);
+            ++a;
+        } else {
+            if (a->url != b->url) {
+                delta.relocated.push_back(*a);
+            } else if (a->revision != b->revision) {
+                delta.revised.push_back(*a);
+            }
+            ++a;
+            ++b;
+        }
+    }
+    return delta;
+}
+
+CacheRefresh refresh_template_cache(const RegistryDelta& delta,
+                                    const fs::path& cacheRoot,
+                                    const fs::path& compiledRoot) {
+    std::vector<CacheWork> work;
+    for (const auto& id : delta.removed) {
+        work.push_back({Action::Evict, id, {}});
+    }
+    for (const auto* list : {&delta.added, &delta.relocated}) {
+        for (const auto& source : *list) {
+            work.push_back({Action::Reclone, source.id, source.url});
+        }
+    }
+    for (const auto& source : delta.revised) {
+        work.push_back({Action::Pull, source.id, source.url});
+    }
+    // Only templates that were cached need any work.
+    work.erase(std::remove_if(work.begin(), work.end(),
+                              [&](const CacheWork& w) {
+                                  std::error_code ec;
+                                  return !is_cacheable_id(w.id) ||
+                                         !fs::exists(cacheRoot / w.id, ec);
+                              }),
+               work.end());
+
+    std::vector<Outcome> outcomes(work.size(), Outcome::Failed);
+    util::parallel_for(work.size(),
+                       static_cast<unsigned>(std::min(work.size(), kMaxConcurrentRefreshes)),
+                       [&](std::size_t i) {
+        outcomes[i] = refresh_one(work[i], cacheRoot, compiledRoot);
+    });
+
+    CacheRefresh refresh;
+    for (std::size_t i = 0; i < work.size(); ++i) {
+        switch (outcomes[i]) {
+        case Outcome::Evicted: refresh.evicted.push_back(work[i].id); break;
+        case Outcome::Recloned: refresh.recloned.push_back(work[i].id); break;
+        case Outcome::Pulled: refresh.pulled.push_back(work[i].id); break;
+        case Outcome::Failed: refresh.failed.push_back(work[i].id); break;
+        }
+    }
+    for (auto* ids : {&refresh.pulled, &refresh.evicted, &refresh.recloned, &refresh.failed}) {
+        std::sort(ids->begin(), ids->end());
+    }
+    return refresh;
+}
+
+} // namespace cpp_hub
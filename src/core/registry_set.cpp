@@ -0,0 +1,273 @@
+// src/core/registry_set.cpp
+#include "cpp_hub/registry_set.hpp"
+#include "cpp_hub/config.hpp"
+#include "cpp_hub/util/thread_pool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+using nlohmann::json;
+
+namespace cpp_hub {
+
+namespace {
+
+// Registry names become directory names, so keep them to a safe alphabet.
+bool is_valid_registry_name(const std::string& name) {
+    if (name.empty() || name[0] == '.') {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '-' || c == '_' || c == '.';
+    });
+}
+
+} // namespace
+
+std::vector<RegistrySource> load_registry_sources() {
+    const fs::path configPath = registries_config_path();
+    std::error_code ec;
+    if (!fs::exists(configPath, ec)) {
+        return {{"default", default_registry_url(), registry_path()}};
+    }
+
+    std::ifstream in(configPath);
+    if (!in) {
+        throw std::runtime_error("Could not open registry list: " + configPath.string());
+    }
+    json j;
+    try {
+        in >> j;
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Failed to parse registries.json: ") + e.what());
+    }
+    if (!j.contains("registries") || !j["registries"].is_array()) {
+        throw std::runtime_error("registries.json missing 'registries' array.");
+    }
+
+    std::vector<RegistrySource> sources;
+    std::set<std::string> names;
+    for (const auto& entry : j["registries"]) {
+        if (!entry.is_object() || !entry.contains("name") || !entry["name"].is_string() ||
+            !entry.contains("url") || !entry["url"].is_string()) {
+            throw std::runtime_error("Registry entry missing string field 'name' or 'url'.");
+        }
+        RegistrySource source;
+        source.name = entry["name"].get<std::string>();
+        source.url = entry["url"].get<std::string>();
+        if (!is_valid_registry_name(source.name)) {
+            throw std::runtime_error("Invalid registry name '" + source.name + "'.");
+        }
+        if (!names.insert(source.name).second) {
+            throw std::runtime_error("Registry '" + source.name + "' is listed twice.");
+        }
+        source.path = registries_root() / source.name;
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty()) {
+        throw std::runtime_error("registries.json lists no registries.");
+    }
+    return sources;
+}
+
+RegistrySet::RegistrySet()
+    : RegistrySet(load_registry_sources()) {}
+
+RegistrySet::RegistrySet(std::vector<RegistrySource> sources)
+    : sources_(std::move(sources)) {
+    for (const auto& source : sources_) {
+        registries_.push_back(std::make_unique<Registry>(source.path, source.url));
+    }
+}
+
+void RegistrySet::ensure_initialized() {
+    std::vector<std::string> failed;
+    load_all(false, failed);
+    if (loaded_.empty()) {
+        throw std::runtime_error("No registry could be loaded.");
+    }
+}
+
+std::vector<std::string> RegistrySet::update(RegistryDelta& delta) {
+    // What each existing clone held before the pull.
+    std::vector<std::vector<TemplateSource>> before(sources_.size());
+    util::parallel_for(sources_.size(), static_cast<unsigned>(sources_.size()),
+                       [&](std::size_t i) {
+        std::error_code ec;
+        if (!fs::exists(sources_[i].path, ec)) {
+            return;
+        }
+        try {
+            registries_[i]->reload();
+            before[i] = template_sources(*registries_[i]);
+        } catch (const std::exception&) {
+            // Unreadable before the pull; everything in it counts as added.
+        }
+    });
+
+    std::vector<std::string> failed;
+    load_all(true, failed);
+
+    std::vector<std::vector<TemplateSource>> after(sources_.size());
+    for (std::size_t i = 0, r = 0; i < sources_.size(); ++i) {
+        if (r < loaded_.size() && loaded_[r] == i) {
+            after[i] = template_sources(registry(r++));
+        } else {
+            after[i] = before[i];
+        }
+    }
+    delta = diff_template_sources(merge_template_sources(before),
+                                  merge_template_sources(after));
+    return failed;
+}
+
+void RegistrySet::load_all(bool pull, std::vector<std::string>& failed) {
+    std::vector<std::string> errors(sources_.size());
+    util::parallel_for(sources_.size(), static_cast<unsigned>(sources_.size()),
+                       [&](std::size_t i) {
+        try {
+            if (pull) {
+                registries_[i]->update();
+            } else {
+                registries_[i]->ensure_initialized();
+            }
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    });
+
+    loaded_.clear();
+    for (std::size_t i = 0; i < sources_.size(); ++i) {
+        if (errors[i].empty()) {
+            loaded_.push_back(i);
+            continue;
+        }
+        failed.push_back(sources_[i].name);
+        if (sources_.size() == 1) {
+            throw std::runtime_error(errors[i]);
+        }
+        std::cerr << "Warning: registry '" << sources_[i].name << "' unavailable: "
+                  << errors[i] << "\n";
+    }
+    merged_.clear();
+    mergedIndex_.clear();
+    mergedReady_ = false;
+}
+
+void RegistrySet::ensure_merged() const {
+    if (mergedReady_ || loaded_.size() <= 1) {
+        return;
+    }
+    mergedReady_ = true;
+
+    // Each registry is sorted by id: merge them, taking an id from the
+    // earliest registry that has it and skipping it in the others.
+    std::vector<std::size_t> cursors(loaded_.size(), 0);
+    for (std::size_t r = 0; r < loaded_.size(); ++r) {
+        mergedIndex_.emplace_back(registry(r).size(), kShadowed);
+    }
+    for (;;) {
+        std::optional<std::size_t> best;
+        std::string_view bestId;
+        for (std::size_t r = 0; r < loaded_.size(); ++r) {
+            if (cursors[r] == registry(r).size()) {
+                continue;
+            }
+            const std::string_view id = registry(r).at(cursors[r]).id();
+            if (!best || id < bestId) {
+                best = r;
+                bestId = id;
+            }
+        }
+        if (!best) {
+            return;
+        }
+        mergedIndex_[*best][cursors[*best]] = static_cast<std::uint32_t>(merged_.size());
+        merged_.push_back({static_cast<std::uint32_t>(*best),
+                           static_cast<std::uint32_t>(cursors[*best])});
+        for (std::size_t r = 0; r < loaded_.size(); ++r) {
+            if (cursors[r] < registry(r).size() && registry(r).at(cursors[r]).id() == bestId) {
+                ++cursors[r];
+            }
+        }
+    }
+}
+
+std::size_t RegistrySet::merged_index(std::size_t r, std::size_t ordinal) const {
+    return mergedIndex_.empty() ? ordinal : mergedIndex_[r][ordinal];
+}
+
+std::size_t RegistrySet::size() const {
+    ensure_merged();
+    return loaded_.size() == 1 ? registry(0).size() : merged_.size();
+}
+
+TemplateView RegistrySet::at(std::size_t i) const {
+    if (loaded_.size() == 1) {
+        return registry(0).at(i);
+    }
+    ensure_merged();
+    return registry(merged_[i].registry).at(merged_[i].ordinal);
+}
+
+std::optional<TemplateView> RegistrySet::find_template(std::string_view id) const {
+    for (std::size_t r = 0; r < loaded_.size(); ++r) {
+        if (auto t = registry(r).find_template(id)) {
+            return t;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<SearchHit> RegistrySet::search(std::string_view query, std::size_t limit) const {
+    if (loaded_.size() == 1) {
+        return registry(0).search(query, limit);
+    }
+    ensure_merged();
+
+    std::vector<std::vector<SearchHit>> perRegistry(loaded_.size());
+    util::parallel_for(loaded_.size(), static_cast<unsigned>(loaded_.size()),
+                       [&](std::size_t r) {
+        perRegistry[r] = registry(r).search(query, limit, [&](std::size_t ordinal) {
+            return mergedIndex_[r][ordinal] != kShadowed;
+        });
+    });
+
+    std::vector<SearchHit> hits;
+    for (std::size_t r = 0; r < loaded_.size(); ++r) {
+        for (const auto& hit : perRegistry[r]) {
+            hits.push_back({merged_index(r, hit.ordinal), hit.score});
+        }
+    }
+    rank_hits(hits, limit);
+    return hits;
+}
+
+std::vector<std::size_t> RegistrySet::with_tags(const TagQuery& query) const {
+    if (loaded_.size() == 1) {
+        return registry(0).with_tags(query);
+    }
+    ensure_merged();
+
+    std::vector<std::size_t> found;
+    for (std::size_t r = 0; r < loaded_.size(); ++r) {
+        for (const std::size_t ordinal : registry(r).with_tags(query)) {
+            const std::size_t i = merged_index(r, ordinal);
+            if (i != kShadowed) {
+                found.push_back(i);
+            }
+        }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+} // namespace cpp_hub
@@ -1,53 +1,590 @@
 // src/core/renderer.cpp
 #include "cpp_hub/renderer.hpp"
-#include "cpp_hub/util/string_utils.hpp"
+#include "cpp_hub/generation_record.hpp"
+#include "cpp_hub/output_backend.hpp"
+#include "cpp_hub/scan.hpp"
+#include "cpp_hub/substitution.hpp"
+#include "cpp_hub/template_cache.hpp"
+#include "cpp_hub/template_walker.hpp"
+#include "cpp_hub/util/alloc_counter.hpp"
+#include "cpp_hub/util/fs.hpp"
+#include "cpp_hub/util/mapped_file.hpp"
+#include "cpp_hub/util/thread_pool.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <system_error>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace cpp_hub {
 
-static std::string apply_substitutions(
-    std::string text,
-    const std::unordered_map<std::string, std::string>& values) {
+namespace {
 
-    for (const auto& [key, value] : values) {
-        const std::string token = "{{" + key + "}}";
-        std::string::size_type pos = 0;
-        while ((pos = text.find(token, pos)) != std::string::npos) {
-            text.replace(pos, token.size(), value);
-            pos += value.size();
+// Read size used when streaming files above RenderOptions::streamingThreshold.
+constexpr std::size_t kStreamChunkSize = 1 << 20;
+// Piece size used when substituting one file above
+// RenderOptions::parallelThreshold on several threads.
+constexpr std::size_t kSegmentSize = 4 << 20;
+// Per-thread render buffers that grew beyond this are released after use.
+constexpr std::size_t kKeptBufferSize = 1 << 20;
+
+struct RenderEntry {
+    fs::path source;
+    std::string destRel; // destination relative to the target root, substituted
+    bool directory;
+    // Pre-scanned tokens for this file, when rendering from a compiled template.
+    const CompiledEntry* compiled = nullptr;
+};
+
+// Everything a render task needs besides the entry itself.
+struct RenderContext {
+    const SubstitutionTable& table;
+    const fs::path& targetRoot;
+    std::uint64_t streamingThreshold;
+    std::uint64_t parallelThreshold;
+    unsigned jobs;
+    OutputBackend& output;
+    // Replacement for each key of the compiled template (nullptr = unknown).
+    std::vector<const std::string*> compiledValues;
+};
+
+// Buffers reused from one file to the next by each render thread, so that
+// rendering a file does not allocate once they have grown to fit.
+struct RenderBuffers {
+    std::vector<TokenSpan> spans;
+    std::string rendered;
+};
+
+// Files left for after the per-file loop because they are big enough to be
+// rendered on several threads themselves; see render_file.
+struct DeferredFiles {
+    std::mutex mutex;
+    std::vector<std::size_t> tags;
+};
+
+RenderBuffers& thread_render_buffers() {
+    thread_local RenderBuffers buffers;
+    return buffers;
+}
+
+} // namespace
+
+// Format "<what> <path>" the same way the rest of the renderer streams paths.
+static std::string path_message(const char* what, const fs::path& p) {
+    std::ostringstream os;
+    os << what << " " << p;
+    return os.str();
+}
+
+// Turn pre-scanned tokens into spans over a text, dropping the first `skip`
+// bytes of it. Tokens whose key has no value are left in place.
+static std::size_t compiled_spans(
+    std::span<const PackedToken> tokens,
+    std::size_t textSize,
+    std::size_t skip,
+    const RenderContext& ctx,
+    std::vector<TokenSpan>& spans) {
+
+    std::size_t outputSize = textSize - skip;
+    for (const auto& t : tokens) {
+        const std::string* value = ctx.compiledValues[t.key];
+        if (!value) continue;
+        spans.push_back({static_cast<std::size_t>(t.offset) - skip, t.length, value});
+        outputSize = outputSize - t.length + value->size();
+    }
+    return outputSize;
+}
+
+// Generic form of p relative to root, without a trailing slash: "" when p
+// is root itself, or "-" if p is not inside root.
+static std::string relative_inside(const fs::path& p, const fs::path& root) {
+    std::string rel = p.lexically_normal()
+                          .lexically_relative(root.lexically_normal())
+                          .generic_string();
+    if (rel.empty() || rel.rfind("..", 0) == 0) {
+        return "-";
+    }
+    if (rel == "." || rel == "./") {
+        return {};
+    }
+    if (rel.back() == '/') {
+        rel.pop_back();
+    }
+    return rel;
+}
+
+// True if relPath is `dir` or lies underneath it.
+static bool is_within(std::string_view relPath, std::string_view dir) {
+    return relPath.rfind(dir, 0) == 0 &&
+           (relPath.size() == dir.size() || relPath[dir.size()] == '/');
+}
+
+// List the entries of a compiled template that live under layerRoot,
+// leaving out those under any of the pruned directories.
+// Returns false if layerRoot is not inside the compiled template.
+static bool collect_compiled_entries(
+    const CompiledTemplate& compiled,
+    const fs::path& layerRoot,
+    const std::vector<fs::path>& pruned,
+    const RenderContext& ctx,
+    std::vector<RenderEntry>& entries) {
+
+    std::string prefix = relative_inside(layerRoot, compiled.root());
+    if (prefix == "-") {
+        return false;
+    }
+    if (!prefix.empty()) {
+        prefix += '/';
+    }
+
+    std::vector<std::string> prunedRel;
+    for (const auto& p : pruned) {
+        std::string rel = relative_inside(p, layerRoot);
+        if (rel != "-" && !rel.empty()) {
+            prunedRel.push_back(prefix + rel);
+        }
+    }
+
+    std::vector<TokenSpan> spans;
+    for (const auto& e : compiled.entries()) {
+        if (e.relPath.size() <= prefix.size() || e.relPath.rfind(prefix, 0) != 0) {
+            continue;
+        }
+        bool skip = false;
+        for (const auto& dir : prunedRel) {
+            skip = skip || is_within(e.relPath, dir);
+        }
+        if (skip) {
+            continue;
+        }
+        const std::string_view rel = e.relPath.substr(prefix.size());
+
+        // Tokens inside the overlay prefix itself are not part of the
+        // destination path; re-scan in the (unusual) case that one exists.
+        bool tokenInPrefix = false;
+        for (const auto& t : e.pathTokens) {
+            tokenInPrefix = tokenInPrefix || t.offset < prefix.size();
+        }
+
+        std::string relStr;
+        if (tokenInPrefix) {
+            relStr = apply_substitutions(rel, ctx.table);
+        } else {
+            spans.clear();
+            relStr.reserve(compiled_spans(e.pathTokens, e.relPath.size(), prefix.size(),
+                                          ctx, spans));
+            splice_tokens(rel, spans, relStr);
+        }
+
+        entries.push_back({compiled.root() / fs::path(e.relPath), std::move(relStr),
+                           e.directory, &e});
+    }
+    return true;
+}
+
+// List the entries of one layer by walking it on disk. Ignore patterns are
+// relative to templateRoot, the base layer.
+static bool collect_walked_entries(
+    const fs::path& layerRoot,
+    const fs::path& templateRoot,
+    const std::vector<fs::path>& pruned,
+    const IgnoreMatcher* ignore,
+    const RenderContext& ctx,
+    std::vector<RenderEntry>& entries) {
+
+    std::vector<std::string> prunedRel;
+    for (const auto& p : pruned) {
+        std::string rel = relative_inside(p, layerRoot);
+        if (rel != "-" && !rel.empty()) {
+            prunedRel.push_back(std::move(rel));
+        }
+    }
+
+    std::string ignorePrefix = relative_inside(layerRoot, templateRoot);
+    if (ignorePrefix == "-") {
+        ignorePrefix.clear();
+    }
+
+    std::vector<WalkEntry> walked;
+    if (!walk_template(layerRoot, walked, prunedRel, ignore, ignorePrefix)) {
+        return false;
+    }
+    entries.reserve(entries.size() + walked.size());
+    for (auto& w : walked) {
+        entries.push_back({std::move(w.source), apply_substitutions(w.relPath, ctx.table),
+                           w.directory});
+    }
+    return true;
+}
+
+// Resolve all layers into a single list with one entry per destination path.
+// A later layer's entry replaces an earlier one in place; new paths are
+// appended in walk order, so parents still precede their children.
+static bool collect_merged_entries(
+    const std::vector<fs::path>& layers,
+    const std::vector<fs::path>& pruned,
+    const CompiledTemplate* compiled,
+    const IgnoreMatcher* ignore,
+    const RenderContext& ctx,
+    std::vector<RenderEntry>& merged) {
+
+    std::unordered_map<std::string, std::size_t> byDest;
+    for (const auto& layer : layers) {
+        std::vector<RenderEntry> entries;
+        if (!compiled || !collect_compiled_entries(*compiled, layer, pruned, ctx, entries)) {
+            if (!collect_walked_entries(layer, layers.front(), pruned, ignore, ctx, entries)) {
+                return false;
+            }
+        }
+
+        if (merged.empty()) {
+            merged = std::move(entries);
+            byDest.reserve(merged.size());
+            for (std::size_t i = 0; i < merged.size(); ++i) {
+                byDest.emplace(merged[i].destRel, i);
+            }
+            continue;
+        }
+
+        for (auto& entry : entries) {
+            auto [it, inserted] = byDest.emplace(entry.destRel, merged.size());
+            if (inserted) {
+                merged.push_back(std::move(entry));
+            } else if (!(entry.directory && merged[it->second].directory)) {
+                merged[it->second] = std::move(entry);
+            }
+        }
+    }
+
+    // Drop directories that existed only to hold pruned sources, such as an
+    // "overlays/" folder, so they do not show up empty in the output.
+    for (std::size_t i = 0; i < merged.size();) {
+        const RenderEntry& dir = merged[i];
+        if (!dir.directory) {
+            ++i;
+            continue;
+        }
+        bool holdsPruned = false;
+        for (const auto& p : pruned) {
+            const std::string rel = relative_inside(p, dir.source);
+            holdsPruned = holdsPruned || (rel != "-" && !rel.empty());
+        }
+        bool hasChildren = false;
+        for (std::size_t j = 0; holdsPruned && !hasChildren && j < merged.size(); ++j) {
+            hasChildren = j != i && is_within(merged[j].destRel, dir.destRel);
+        }
+        if (holdsPruned && !hasChildren) {
+            merged.erase(merged.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            ++i;
+        }
+    }
+    return true;
+}
+
+// Render a file too large to hold in memory, one chunk at a time. Unless the
+// caller already knows the file has tokens, it is first classified by a
+// chunked scan so that binary and token-free files are still copied verbatim.
+static bool stream_file(
+    std::size_t tag,
+    const fs::path& source,
+    const fs::path& dest,
+    fs::perms perms,
+    bool knownToHaveTokens,
+    const RenderContext& ctx,
+    std::string& error) {
+
+    std::ifstream in(source, std::ios::binary);
+    if (!in) {
+        error = path_message("Failed to open template file", source);
+        return false;
+    }
+    std::string chunk(kStreamChunkSize, '\0');
+    auto read_chunk = [&]() -> std::string_view {
+        in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        return {chunk.data(), static_cast<std::size_t>(in.gcount())};
+    };
+
+    if (!knownToHaveTokens) {
+        bool hasToken = false;
+        bool binary = false;
+        char prev = '\0';
+        for (std::string_view view = read_chunk(); !view.empty() && !binary;
+             view = read_chunk()) {
+            const ScanResult scan = scan_buffer(view);
+            binary = scan.binary;
+            hasToken = hasToken || scan.firstToken != std::string_view::npos ||
+                       (prev == '{' && view.front() == '{');
+            prev = view.back();
+        }
+        if (binary || !hasToken) {
+            in.close();
+            return ctx.output.copy_file(tag, source, dest, {}, perms, error);
+        }
+        in.clear();
+        in.seekg(0);
+    }
+
+    std::unique_ptr<OutputStream> out = ctx.output.open_stream(tag, dest, perms, error);
+    if (!out) {
+        return false;
+    }
+
+    StreamingSubstitution substitution(ctx.table);
+    std::string rendered;
+    rendered.reserve(kStreamChunkSize);
+    for (std::string_view view = read_chunk(); !view.empty(); view = read_chunk()) {
+        rendered.clear();
+        substitution.feed(view, rendered);
+        if (!out->write(rendered, error)) {
+            return false;
+        }
+    }
+    if (in.bad()) {
+        error = path_message("Failed to read template file", source);
+        return false;
+    }
+    rendered.clear();
+    substitution.finish(rendered);
+    return out->write(rendered, error) && out->close(error);
+}
+
+// Render one huge file on several threads: cut it at token-safe boundaries
+// and have `jobs` workers take pieces in order, substitute them and append
+// their output in turn, so memory use is bounded by jobs * kSegmentSize.
+// Only called when no other file is being rendered (see render_file).
+static bool render_file_parallel(
+    std::size_t tag,
+    const fs::path& source,
+    const fs::path& dest,
+    const util::MappedFile& in,
+    bool knownToHaveTokens,
+    const RenderContext& ctx,
+    std::string& error) {
+
+    const std::string_view content = in.view();
+
+    if (!knownToHaveTokens) {
+        // Classify in parallel as well. Each slice also sees the first byte
+        // of the next one, so a "{{" across a slice edge is not missed.
+        const std::size_t slices = (content.size() + kSegmentSize - 1) / kSegmentSize;
+        std::atomic<bool> binary{false};
+        std::atomic<bool> hasToken{false};
+        util::parallel_for(slices, ctx.jobs, [&](std::size_t i) {
+            if (binary.load(std::memory_order_relaxed)) return;
+            const ScanResult scan = scan_buffer(content.substr(i * kSegmentSize, kSegmentSize + 1));
+            if (scan.binary) binary = true;
+            if (scan.firstToken != std::string_view::npos) hasToken = true;
+        });
+        if (binary || !hasToken) {
+            return ctx.output.copy_file(tag, source, dest, {}, in.permissions(), error);
         }
     }
-    return text;
+
+    const std::vector<std::size_t> cuts =
+        split_at_safe_boundaries(content, ctx.table, kSegmentSize);
+    const std::size_t pieces = cuts.size() - 1;
+
+    std::unique_ptr<OutputStream> out = ctx.output.open_stream(tag, dest, in.permissions(), error);
+    if (!out) {
+        return false;
+    }
+
+    // Pieces are claimed in order, so the piece a worker waits for has
+    // always been claimed by a running worker.
+    std::mutex mutex;
+    std::condition_variable turn;
+    std::size_t nextClaim = 0;
+    std::size_t nextWrite = 0;
+    bool failed = false;
+    const std::size_t workers = std::min<std::size_t>(ctx.jobs, pieces);
+    util::parallel_for(workers, static_cast<unsigned>(workers), [&](std::size_t) {
+        std::string output;
+        std::vector<TokenSpan> spans;
+        for (;;) {
+            std::size_t p = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (failed || nextClaim == pieces) {
+                    return;
+                }
+                p = nextClaim++;
+            }
+            std::string writeError;
+            bool ok = false;
+            try {
+                const std::string_view piece = content.substr(cuts[p], cuts[p + 1] - cuts[p]);
+                spans.clear();
+                const std::size_t size = find_tokens(piece, ctx.table, spans);
+                output.clear();
+                output.reserve(size);
+                splice_tokens(piece, spans, output);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                turn.wait(lock, [&] { return failed || nextWrite == p; });
+                if (failed) {
+                    return;
+                }
+                // Only this worker can write now; let the others claim meanwhile.
+                lock.unlock();
+                ok = out->write(output, writeError);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+                turn.notify_all();
+                throw;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok && !failed) {
+                failed = true;
+                error = std::move(writeError);
+            }
+            ++nextWrite;
+            turn.notify_all();
+        }
+    });
+    return !failed && out->close(error);
 }
 
-static bool path_contains_git_dir(const fs::path& p, const fs::path& root) {
-    fs::path cur = p;
-    while (cur != root && !cur.empty()) {
-        if (cur.filename() == ".git") {
+// Find the tokens to substitute in a file's content, from its compiled entry
+// if there is one. Returns the size of the rendered output.
+static std::size_t content_spans(
+    const CompiledEntry* compiled,
+    std::string_view content,
+    const RenderContext& ctx,
+    std::vector<TokenSpan>& spans) {
+
+    if (compiled) {
+        return compiled_spans(compiled->contentTokens, content.size(), 0, ctx, spans);
+    }
+    // Binary files and files without any "{{" are copied verbatim, letting
+    // the kernel (or the filesystem, via reflinks) move the bytes.
+    const ScanResult scan = scan_buffer(content);
+    if (!scan.binary && scan.firstToken != std::string::npos) {
+        return find_tokens(content, ctx.table, spans);
+    }
+    return content.size();
+}
+
+// While other files are being rendered in parallel, `deferred` is set and a
+// file big enough to be rendered on several threads itself is only noted
+// there, to be rendered once the others are done.
+static bool render_file(
+    std::size_t tag,
+    const RenderEntry& entry,
+    const fs::path& dest,
+    const RenderContext& ctx,
+    DeferredFiles* deferred,
+    std::string& error) {
+
+    std::error_code ec;
+    util::MappedFile in;
+    if (!in.open(entry.source, ec)) {
+        error = path_message("Failed to open template file", entry.source);
+        return false;
+    }
+    const std::string_view content = in.view();
+
+    // If the checkout changed under a compiled template, scan the file as
+    // it is now.
+    const CompiledEntry* compiled = entry.compiled;
+    if (compiled && !compiled->matches(in)) {
+        compiled = nullptr;
+    }
+    if (compiled && compiled->verbatim) {
+        return ctx.output.copy_known_file(tag, entry.source, dest, content, compiled->digest,
+                                          in.permissions(), error);
+    }
+
+    if (ctx.jobs > 1 && content.size() >= ctx.parallelThreshold) {
+        if (deferred) {
+            std::lock_guard<std::mutex> lock(deferred->mutex);
+            deferred->tags.push_back(tag);
             return true;
         }
-        cur = cur.parent_path();
+        return render_file_parallel(tag, entry.source, dest, in, compiled != nullptr, ctx,
+                                    error);
+    }
+    if (content.size() > ctx.streamingThreshold) {
+        const fs::perms perms = in.permissions();
+        in.close();
+        return stream_file(tag, entry.source, dest, perms, compiled != nullptr, ctx, error);
+    }
+
+    RenderBuffers& buffers = thread_render_buffers();
+    buffers.spans.clear();
+    const std::size_t outputSize = content_spans(compiled, content, ctx, buffers.spans);
+    if (buffers.spans.empty()) {
+        return ctx.output.copy_file(tag, entry.source, dest, content, in.permissions(), error);
+    }
+
+    std::string& rendered = buffers.rendered;
+    rendered.clear();
+    rendered.reserve(outputSize);
+    splice_tokens(content, buffers.spans, rendered);
+    const bool ok = ctx.output.write_file(tag, dest, rendered, in.permissions(), error);
+    if (rendered.capacity() > kKeptBufferSize) {
+        std::string().swap(rendered);
     }
-    return false;
+    return ok;
 }
 
 bool render_template(
     const fs::path& templateRoot,
     const fs::path& targetRoot,
     const std::unordered_map<std::string, std::string>& values,
-    bool allowExisting) {
+    const RenderOptions& options) {
+    return render_layers({templateRoot}, {}, targetRoot, values, options);
+}
+
+bool render_layers(
+    const std::vector<fs::path>& layers,
+    const std::vector<fs::path>& pruned,
+    const fs::path& targetRoot,
+    const std::unordered_map<std::string, std::string>& values,
+    const RenderOptions& options) {
 
     std::error_code ec;
+    const SubstitutionTable table(values);
+    std::unique_ptr<OutputBackend> builtin;
+    OutputBackend* output = options.output;
+    if (!output && options.useIoUring) {
+        builtin = make_io_uring_output(options.allowExisting);
+    }
+    if (!output && !builtin) {
+        builtin = make_posix_output();
+    }
+    if (!output) {
+        output = builtin.get();
+    }
+    std::unique_ptr<RecordingOutput> recorder;
+    if (options.record) {
+        recorder = std::make_unique<RecordingOutput>(*output, targetRoot, options.previousRecord);
+        output = recorder.get();
+    }
+    RenderContext ctx{table,
+                      targetRoot,
+                      options.streamingThreshold,
+                      options.parallelThreshold,
+                      options.jobs == 0 ? util::default_jobs() : options.jobs,
+                      *output,
+                      {}};
 
-    if (fs::exists(targetRoot, ec)) {
-        if (!allowExisting) {
+    if (options.output) {
+        // The backend decides where the output goes; targetRoot only names it.
+    } else if (fs::exists(targetRoot, ec)) {
+        if (!options.allowExisting) {
             std::cerr << "Target path already exists: " << targetRoot << "\n";
             return false;
         }
@@ -64,76 +601,199 @@ bool render_template(
     }
 
     try {
-        fs::recursive_directory_iterator it(
-            templateRoot, fs::directory_options::skip_permission_denied), end;
-        for (; it != end; ++it) {
-            const fs::path srcPath = it->path();
-
-            if (path_contains_git_dir(srcPath, templateRoot)) {
-                if (it->is_directory() && srcPath.filename() == ".git") {
-                    it.disable_recursion_pending();
-                }
-                continue;
+        if (options.compiled) {
+            for (const auto& key : options.compiled->keys()) {
+                ctx.compiledValues.push_back(table.find(key));
             }
+        }
 
-            fs::path rel = fs::relative(srcPath, templateRoot, ec);
-            if (ec) {
-                std::cerr << "Failed to compute relative path for " << srcPath
-                          << ": " << ec.message() << "\n";
-                return false;
-            }
+        std::vector<RenderEntry> entries;
+        if (!collect_merged_entries(layers, pruned, options.compiled, options.ignore, ctx,
+                                    entries)) {
+            return false;
+        }
 
-            // Skip manifest itself
-            if (rel.filename() == "hub-manifest.json") {
-                if (it->is_directory()) {
-                    it.disable_recursion_pending();
-                }
+        // Directories are all created before any file is written, so that
+        // render tasks never race on a missing parent.
+        std::vector<const RenderEntry*> files;
+        std::vector<fs::path> fileDests;
+        std::vector<fs::path> dirs;
+        fs::path lastParent;
+        for (const auto& entry : entries) {
+            fs::path dest = targetRoot / fs::path(entry.destRel);
+            if (entry.directory) {
+                dirs.push_back(std::move(dest));
                 continue;
             }
+            fs::path parent = dest.parent_path();
+            if (parent != lastParent && parent != targetRoot) {
+                dirs.push_back(parent);
+                lastParent = std::move(parent);
+            }
+            files.push_back(&entry);
+            fileDests.push_back(std::move(dest));
+        }
+        std::string dirError;
+        if (!output->create_directories(dirs, dirError)) {
+            std::cerr << dirError << "\n";
+            return false;
+        }
 
-            std::string relStr = rel.generic_string();
-            relStr = apply_substitutions(relStr, values);
-            fs::path destPath = targetRoot / fs::path(relStr);
+        // Tasks past the earliest failure are skipped; tasks before it still
+        // run, so the reported error does not depend on thread scheduling.
+        constexpr std::size_t noFailure = std::numeric_limits<std::size_t>::max();
+        std::atomic<std::size_t> firstFailure{noFailure};
+        std::vector<std::string> errors(files.size());
 
-            if (it->is_directory()) {
-                if (!fs::create_directories(destPath, ec) && ec) {
-                    std::cerr << "Failed to create directory " << destPath
-                              << ": " << ec.message() << "\n";
-                    return false;
+        // Huge files are rendered on all threads one after another, once
+        // the rest are done, rather than nesting thread pools.
+        DeferredFiles deferred;
+        DeferredFiles* defer = ctx.jobs > 1 && files.size() > 1 ? &deferred : nullptr;
+        auto render = [&](std::size_t i, DeferredFiles* deferTo) {
+            if (i > firstFailure.load(std::memory_order_relaxed)) {
+                return;
+            }
+            bool ok = false;
+            try {
+                ok = render_file(i, *files[i], fileDests[i], ctx, deferTo, errors[i]);
+            } catch (const std::exception& e) {
+                errors[i] = std::string("Error while rendering template: ") + e.what();
+            }
+            if (!ok) {
+                std::size_t cur = firstFailure.load(std::memory_order_relaxed);
+                while (i < cur && !firstFailure.compare_exchange_weak(cur, i)) {
                 }
-                continue;
             }
+        };
 
-            if (!it->is_regular_file()) {
-                continue;
+        const std::uint64_t allocationsBefore = util::heap_allocations();
+        util::parallel_for(files.size(), ctx.jobs, [&](std::size_t i) { render(i, defer); });
+        std::sort(deferred.tags.begin(), deferred.tags.end());
+        for (const std::size_t i : deferred.tags) {
+            render(i, nullptr);
+        }
+
+        // Writes the backend completed asynchronously fail in any order.
+        for (auto& failure : output->finish()) {
+            if (failure.tag < firstFailure) {
+                firstFailure = failure.tag;
+                errors[failure.tag] = std::move(failure.message);
             }
+        }
 
-            fs::create_directories(destPath.parent_path(), ec);
+        if (firstFailure != noFailure) {
+            std::cerr << errors[firstFailure] << "\n";
+            return false;
+        }
+        if (options.stats) {
+            options.stats->files = files.size();
+            options.stats->heapAllocations = util::heap_allocations() - allocationsBefore;
+        }
 
-            std::ifstream in(srcPath, std::ios::binary);
-            if (!in) {
-                std::cerr << "Failed to open template file " << srcPath << "\n";
+        if (recorder) {
+            std::string recordError;
+            if (!recorder->complete(*options.record, options.summary, recordError)) {
+                std::cerr << recordError << "\n";
                 return false;
             }
+            save_generation_record(targetRoot, *options.record);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error while rendering template: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool plan_layers(
+    const std::vector<fs::path>& layers,
+    const std::vector<fs::path>& pruned,
+    const std::unordered_map<std::string, std::string>& values,
+    const RenderOptions& options,
+    RenderPlan& plan) {
+
+    using Clock = std::chrono::steady_clock;
+    const SubstitutionTable table(values);
+    // Nothing is written; the backend only completes the context.
+    const std::unique_ptr<OutputBackend> output = make_posix_output();
+    const fs::path noTarget;
+    RenderContext ctx{table,
+                      noTarget,
+                      options.streamingThreshold,
+                      options.parallelThreshold,
+                      options.jobs == 0 ? util::default_jobs() : options.jobs,
+                      *output,
+                      {}};
+
+    try {
+        const auto collectStart = Clock::now();
+        if (options.compiled) {
+            for (const auto& key : options.compiled->keys()) {
+                ctx.compiledValues.push_back(table.find(key));
+            }
+        }
+        std::vector<RenderEntry> entries;
+        if (!collect_merged_entries(layers, pruned, options.compiled, options.ignore, ctx,
+                                    entries)) {
+            return false;
+        }
+
+        std::vector<const RenderEntry*> files;
+        plan.directories = 0;
+        for (const auto& entry : entries) {
+            if (entry.directory) {
+                ++plan.directories;
+            } else {
+                files.push_back(&entry);
+            }
+        }
+        const auto scanStart = Clock::now();
+        plan.collectSeconds = std::chrono::duration<double>(scanStart - collectStart).count();
 
-            std::ostringstream buffer;
-            buffer << in.rdbuf();
-            std::string content = buffer.str();
-            std::string rendered = apply_substitutions(content, values);
+        // Same classification as render_file, minus the writing.
+        plan.files.assign(files.size(), {});
+        std::vector<std::string> errors(files.size());
+        util::parallel_for(files.size(), ctx.jobs, [&](std::size_t i) {
+            const RenderEntry& entry = *files[i];
+            PlannedFile& planned = plan.files[i];
+            planned.destRel = entry.destRel;
 
-            std::ofstream out(destPath, std::ios::binary);
-            if (!out) {
-                std::cerr << "Failed to create file " << destPath << "\n";
+            std::error_code ec;
+            util::MappedFile in;
+            if (!in.open(entry.source, ec)) {
+                errors[i] = path_message("Failed to open template file", entry.source);
+                return;
+            }
+            const std::string_view content = in.view();
+            const CompiledEntry* compiled = entry.compiled;
+            if (compiled && !compiled->matches(in)) {
+                compiled = nullptr;
+            }
+            if (compiled && compiled->verbatim) {
+                planned.bytes = planned.outputBytes = content.size();
+                planned.verbatim = true;
+                return;
+            }
+            std::vector<TokenSpan> spans;
+            planned.bytes = content.size();
+            planned.outputBytes = content_spans(compiled, content, ctx, spans);
+            planned.tokens = spans.size();
+            planned.verbatim = spans.empty();
+        });
+        plan.scanSeconds = std::chrono::duration<double>(Clock::now() - scanStart).count();
+
+        for (const auto& error : errors) {
+            if (!error.empty()) {
+                std::cerr << error << "\n";
                 return false;
             }
-            out << rendered;
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error while rendering template: " << e.what() << "\n";
+        std::cerr << "Error while planning template: " << e.what() << "\n";
         return false;
     }
-
     return true;
 }
 
-} // namespace cpp_hub
\ No newline at end of file
+} // namespace cpp_hub
@@ -0,0 +1,168 @@
+// src/core/scan.cpp
+#include "cpp_hub/scan.hpp"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define CPP_HUB_SCAN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(CPP_HUB_SCAN_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CPP_HUB_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace cpp_hub {
+
+namespace {
+
+constexpr std::size_t npos = std::string_view::npos;
+
+// Scalar kernels. They also finish the tails left over by the vector kernels.
+ScanResult scan_scalar_from(const char* data, std::size_t size, std::size_t from,
+                            std::size_t firstToken) {
+    for (std::size_t i = from; i < size; ++i) {
+        if (data[i] == '\0') {
+            return {firstToken, true};
+        }
+        if (firstToken == npos && data[i] == '{' && i + 1 < size && data[i + 1] == '{') {
+            firstToken = i;
+        }
+    }
+    return {firstToken, false};
+}
+
+[[maybe_unused]] ScanResult scan_scalar(const char* data, std::size_t size) {
+    return scan_scalar_from(data, size, 0, npos);
+}
+
+std::size_t find_open_scalar(const char* data, std::size_t size, std::size_t from) {
+    return std::string_view(data, size).find("{{", from);
+}
+
+#ifdef CPP_HUB_SCAN_SSE2
+// Each block compares bytes [i, i+16) and [i+1, i+17) against '{' so that a
+// "{{" pair straddling two blocks is still seen by the first of them.
+ScanResult scan_sse2(const char* data, std::size_t size) {
+    const __m128i brace = _mm_set1_epi8('{');
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t firstToken = npos;
+    std::size_t i = 0;
+    for (; i + 17 <= size; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) != 0) {
+            return {firstToken, true};
+        }
+        if (firstToken == npos) {
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+            const auto pairs = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(a, brace), _mm_cmpeq_epi8(b, brace))));
+            if (pairs != 0) {
+                firstToken = i + static_cast<std::size_t>(std::countr_zero(pairs));
+            }
+        }
+    }
+    return scan_scalar_from(data, size, i, firstToken);
+}
+
+std::size_t find_open_sse2(const char* data, std::size_t size, std::size_t from) {
+    const __m128i brace = _mm_set1_epi8('{');
+    std::size_t i = from;
+    for (; i + 17 <= size; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        const auto pairs = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, brace), _mm_cmpeq_epi8(b, brace))));
+        if (pairs != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(pairs));
+        }
+    }
+    return find_open_scalar(data, size, i);
+}
+#endif
+
+#ifdef CPP_HUB_SCAN_AVX2
+__attribute__((target("avx2")))
+ScanResult scan_avx2(const char* data, std::size_t size) {
+    const __m256i brace = _mm256_set1_epi8('{');
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t firstToken = npos;
+    std::size_t i = 0;
+    for (; i + 33 <= size; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero)) != 0) {
+            return {firstToken, true};
+        }
+        if (firstToken == npos) {
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+            const auto pairs = static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(a, brace), _mm256_cmpeq_epi8(b, brace))));
+            if (pairs != 0) {
+                firstToken = i + static_cast<std::size_t>(std::countr_zero(pairs));
+            }
+        }
+    }
+    return scan_scalar_from(data, size, i, firstToken);
+}
+
+__attribute__((target("avx2")))
+std::size_t find_open_avx2(const char* data, std::size_t size, std::size_t from) {
+    const __m256i brace = _mm256_set1_epi8('{');
+    std::size_t i = from;
+    for (; i + 33 <= size; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+        const auto pairs = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, brace), _mm256_cmpeq_epi8(b, brace))));
+        if (pairs != 0) {
+            return i + static_cast<std::size_t>(std::countr_zero(pairs));
+        }
+    }
+    return find_open_scalar(data, size, i);
+}
+#endif
+
+struct ScanKernel {
+    const char* name;
+    ScanResult (*scan)(const char*, std::size_t);
+    std::size_t (*findOpen)(const char*, std::size_t, std::size_t);
+};
+
+ScanKernel select_kernel() {
+#ifdef CPP_HUB_SCAN_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", scan_avx2, find_open_avx2};
+    }
+#endif
+#ifdef CPP_HUB_SCAN_SSE2
+    return {"sse2", scan_sse2, find_open_sse2};
+#else
+    return {"scalar", scan_scalar, find_open_scalar};
+#endif
+}
+
+const ScanKernel& kernel() {
+    static const ScanKernel k = select_kernel();
+    return k;
+}
+
+} // namespace
+
+ScanResult scan_buffer(std::string_view data) {
+    return kernel().scan(data.data(), data.size());
+}
+
+std::size_t find_token_open(std::string_view text, std::size_t from) {
+    if (from >= text.size()) {
+        return npos;
+    }
+    return kernel().findOpen(text.data(), text.size(), from);
+}
+
+const char* scan_kernel_name() {
+    return kernel().name;
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,150 @@
+// src/core/search_index.cpp
+#include "cpp_hub/search_index.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace cpp_hub {
+
+namespace {
+
+std::uint32_t trigram_at(std::string_view text, std::size_t i) {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 2]));
+}
+
+} // namespace
+
+void fold_case(std::string& s) {
+    for (char& c : s) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+}
+
+void TrigramIndex::Builder::add_text(SearchField field, std::string_view text) {
+    lengths_[static_cast<std::size_t>(field)] += field == SearchField::Tag ? 1 : text.size();
+    for (std::size_t i = 0; i + 3 <= text.size(); ++i) {
+        current_.push_back(trigram_at(text, i));
+    }
+}
+
+void TrigramIndex::Builder::end_template() {
+    std::sort(current_.begin(), current_.end());
+    current_.erase(std::unique(current_.begin(), current_.end()), current_.end());
+    for (const std::uint32_t trigram : current_) {
+        postings_[trigram].push_back(next_);
+    }
+    current_.clear();
+    ++next_;
+}
+
+void TrigramIndex::Builder::write(util::BinaryWriter& w) const {
+    std::vector<std::uint32_t> trigrams;
+    trigrams.reserve(postings_.size());
+    std::size_t total = 0;
+    for (const auto& [trigram, list] : postings_) {
+        trigrams.push_back(trigram);
+        total += list.size();
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+
+    for (const double length : lengths_) {
+        w.put(next_ == 0 ? 0.0 : length / next_);
+    }
+    w.put(static_cast<std::uint32_t>(trigrams.size()));
+    w.put(static_cast<std::uint32_t>(total));
+    w.align(alignof(std::uint32_t));
+    w.put_bytes(trigrams.data(), trigrams.size() * sizeof(std::uint32_t));
+    std::uint32_t start = 0;
+    for (const std::uint32_t trigram : trigrams) {
+        w.put(start);
+        start += static_cast<std::uint32_t>(postings_.at(trigram).size());
+    }
+    w.put(start);
+    for (const std::uint32_t trigram : trigrams) {
+        const auto& list = postings_.at(trigram);
+        w.put_bytes(list.data(), list.size() * sizeof(std::uint32_t));
+    }
+}
+
+void TrigramIndex::decode(util::BinaryReader& r) {
+    for (double& average : averages_) {
+        average = r.get<double>();
+    }
+    const auto trigramCount = r.get<std::uint32_t>();
+    const auto postingCount = r.get<std::uint32_t>();
+    r.align(alignof(std::uint32_t));
+    trigrams_ = {r.get_array<std::uint32_t>(trigramCount), trigramCount};
+    starts_ = {r.get_array<std::uint32_t>(trigramCount + std::size_t{1}),
+               trigramCount + std::size_t{1}};
+    postings_ = {r.get_array<std::uint32_t>(postingCount), postingCount};
+    if (starts_.back() != postingCount) {
+        throw std::runtime_error("search index has invalid posting lists");
+    }
+}
+
+std::span<const std::uint32_t> TrigramIndex::postings_for(std::uint32_t trigram) const {
+    const auto it = std::lower_bound(trigrams_.begin(), trigrams_.end(), trigram);
+    if (it == trigrams_.end() || *it != trigram) {
+        return {};
+    }
+    const std::size_t i = static_cast<std::size_t>(it - trigrams_.begin());
+    const std::uint32_t begin = starts_[i];
+    const std::uint32_t end = starts_[i + 1];
+    if (begin > end || end > postings_.size()) {
+        throw std::runtime_error("search index has invalid posting lists");
+    }
+    return postings_.subspan(begin, end - begin);
+}
+
+bool TrigramIndex::candidates(std::string_view query, std::vector<std::uint32_t>& out) const {
+    if (query.size() < 3) {
+        return false;
+    }
+
+    std::vector<std::uint32_t> trigrams;
+    for (std::size_t i = 0; i + 3 <= query.size(); ++i) {
+        trigrams.push_back(trigram_at(query, i));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // Intersect starting from the shortest list, which bounds the result.
+    std::vector<std::span<const std::uint32_t>> lists;
+    lists.reserve(trigrams.size());
+    for (const std::uint32_t trigram : trigrams) {
+        lists.push_back(postings_for(trigram));
+        if (lists.back().empty()) {
+            out.clear();
+            return true;
+        }
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+    out.assign(lists.front().begin(), lists.front().end());
+    for (std::size_t k = 1; k < lists.size() && !out.empty(); ++k) {
+        // Galloping would only pay off for very uneven lengths; candidates
+        // are few by now, so a binary search per candidate is enough.
+        const auto list = lists[k];
+        auto from = list.begin();
+        std::size_t kept = 0;
+        for (const std::uint32_t ordinal : out) {
+            from = std::lower_bound(from, list.end(), ordinal);
+            if (from == list.end()) {
+                break;
+            }
+            if (*from == ordinal) {
+                out[kept++] = ordinal;
+            }
+        }
+        out.resize(kept);
+    }
+    return true;
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,161 @@
+// src/core/substitution.cpp
+#include "cpp_hub/substitution.hpp"
+#include "cpp_hub/scan.hpp"
+
+#include <algorithm>
+
+namespace cpp_hub {
+
+SubstitutionTable::SubstitutionTable(
+    const std::unordered_map<std::string, std::string>& values)
+    : maxKeyLength_(0) {
+    entries_.reserve(values.size());
+    for (const auto& [key, value] : values) {
+        entries_.emplace(std::string_view(key), &value);
+        maxKeyLength_ = std::max(maxKeyLength_, key.size());
+    }
+}
+
+const std::string* SubstitutionTable::find(std::string_view key) const {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return nullptr;
+    return it->second;
+}
+
+// Scan text for tokens starting before limit. Returns the offset at which a
+// scan of the remaining text must resume: the end of the last token found if
+// it reaches past limit, otherwise limit itself (or text.size()).
+static std::size_t scan_tokens(
+    std::string_view text,
+    std::size_t limit,
+    const SubstitutionTable& table,
+    std::vector<TokenSpan>& spans,
+    std::size_t& outputSize) {
+
+    limit = std::min(limit, text.size());
+    if (table.empty()) {
+        return limit;
+    }
+
+    // A key never contains "}}", so the closing braces of a known token are
+    // always within max_key_length() bytes of the opening ones. Bounding the
+    // search keeps unterminated "{{" from turning the scan quadratic.
+    const std::size_t maxKey = table.max_key_length();
+    std::size_t pos = 0;
+    while (pos < limit) {
+        const std::size_t open = find_token_open(text, pos);
+        if (open == std::string_view::npos || open >= limit) {
+            break;
+        }
+
+        const std::size_t keyStart = open + 2;
+        const std::size_t windowLen = std::min(text.size() - keyStart, maxKey + 2);
+        const std::string_view window = text.substr(keyStart, windowLen);
+        const std::size_t close = window.find("}}");
+        if (close != std::string_view::npos) {
+            if (const std::string* value = table.find(window.substr(0, close))) {
+                const std::size_t tokenLen = close + 4;
+                spans.push_back({open, tokenLen, value});
+                outputSize = outputSize - tokenLen + value->size();
+                pos = open + tokenLen;
+                continue;
+            }
+        }
+
+        // Not a known token; "{{{key}}}" still matches one brace further on.
+        pos = open + 1;
+    }
+    return std::max(pos, limit);
+}
+
+std::size_t find_tokens(
+    std::string_view text,
+    const SubstitutionTable& table,
+    std::vector<TokenSpan>& spans) {
+
+    std::size_t outputSize = text.size();
+    scan_tokens(text, text.size(), table, spans, outputSize);
+    return outputSize;
+}
+
+void splice_tokens(
+    std::string_view text,
+    const std::vector<TokenSpan>& spans,
+    std::string& out) {
+
+    std::size_t pos = 0;
+    for (const auto& span : spans) {
+        out.append(text.data() + pos, span.offset - pos);
+        out.append(*span.value);
+        pos = span.offset + span.length;
+    }
+    out.append(text.data() + pos, text.size() - pos);
+}
+
+std::string apply_substitutions(std::string_view text, const SubstitutionTable& table) {
+    std::vector<TokenSpan> spans;
+    const std::size_t outputSize = find_tokens(text, table, spans);
+
+    std::string out;
+    out.reserve(outputSize);
+    splice_tokens(text, spans, out);
+    return out;
+}
+
+std::vector<std::size_t> split_at_safe_boundaries(
+    std::string_view text,
+    const SubstitutionTable& table,
+    std::size_t target) {
+
+    // A scan can only carry state across offset b through a "{{" that starts
+    // less than max_key_length() + 4 bytes before b, so b is a safe cut if no
+    // "{{" starts in that range.
+    const std::size_t reach = table.max_key_length() + 4;
+    std::vector<std::size_t> cuts{0};
+    std::size_t b = std::max<std::size_t>(target, 1);
+    while (b < text.size()) {
+        const std::size_t from = b > reach ? b - reach : 0;
+        const std::size_t open = find_token_open(text, from);
+        if (open == std::string_view::npos || open >= b) {
+            cuts.push_back(b);
+            b += target;
+        } else {
+            b = open + reach + 1;
+        }
+    }
+    cuts.push_back(text.size());
+    return cuts;
+}
+
+StreamingSubstitution::StreamingSubstitution(const SubstitutionTable& table)
+    : table_(table) {}
+
+void StreamingSubstitution::feed(std::string_view chunk, std::string& out) {
+    pending_.append(chunk.data(), chunk.size());
+    drain(false, out);
+}
+
+void StreamingSubstitution::finish(std::string& out) {
+    drain(true, out);
+}
+
+void StreamingSubstitution::drain(bool last, std::string& out) {
+    // A token starting at p is decided by the bytes up to p + maxKey + 4, so
+    // everything before `safe` can be settled now. The rest is held back.
+    const std::size_t lookahead = table_.max_key_length() + 3;
+    std::size_t safe = pending_.size();
+    if (!last) {
+        safe = safe > lookahead ? safe - lookahead : 0;
+    }
+    if (safe == 0) {
+        return;
+    }
+
+    spans_.clear();
+    std::size_t outputSize = 0;
+    const std::size_t consumed = scan_tokens(pending_, safe, table_, spans_, outputSize);
+    splice_tokens(std::string_view(pending_).substr(0, consumed), spans_, out);
+    pending_.erase(0, consumed);
+}
+
+} // namespace cpp_hub
@@ -0,0 +1,197 @@
+// src/core/tag_index.cpp
+#include "cpp_hub/tag_index.hpp"
+#include "cpp_hub/search_index.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace cpp_hub {
+
+namespace {
+
+// An array container holds at most this many values: beyond it, the 8 KiB
+// bitmap is the smaller form.
+constexpr std::size_t kMaxArrayValues = 4096;
+constexpr std::size_t kWordsPerBitmap = (1u << 16) / 64;
+
+} // namespace
+
+TemplateSet::TemplateSet(std::size_t size, bool full)
+    : size_(size), words_((size + 63) / 64, full ? ~std::uint64_t{0} : 0) {
+    if (full && size % 64 != 0) {
+        words_.back() = (std::uint64_t{1} << (size % 64)) - 1;
+    }
+}
+
+void TemplateSet::intersect(const TemplateSet& other) {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+        words_[i] &= other.words_[i];
+    }
+}
+
+void TemplateSet::unite(const TemplateSet& other) {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+        words_[i] |= other.words_[i];
+    }
+}
+
+void TemplateSet::subtract(const TemplateSet& other) {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+        words_[i] &= ~other.words_[i];
+    }
+}
+
+std::vector<std::size_t> TemplateSet::members() const {
+    std::vector<std::size_t> out;
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+        for (std::uint64_t w = words_[i]; w != 0; w &= w - 1) {
+            out.push_back(i * 64 + static_cast<std::size_t>(std::countr_zero(w)));
+        }
+    }
+    return out;
+}
+
+void TagIndex::Builder::add(std::string_view tag, std::uint32_t ordinal) {
+    std::string folded(tag);
+    fold_case(folded);
+    auto it = tags_.find(folded);
+    if (it == tags_.end()) {
+        it = tags_.emplace(std::move(folded), std::vector<std::uint32_t>{}).first;
+    }
+    if (it->second.empty() || it->second.back() != ordinal) {
+        it->second.push_back(ordinal);
+    }
+}
+
+void TagIndex::Builder::write(util::BinaryWriter& w) const {
+    std::vector<PackedTag> tags;
+    std::vector<PackedContainer> containers;
+    std::vector<std::uint16_t> values;
+    std::vector<std::uint64_t> words;
+    std::string names;
+
+    for (const auto& [name, ordinals] : tags_) {
+        PackedTag tag{};
+        tag.nameOffset = static_cast<std::uint32_t>(names.size());
+        tag.nameLength = static_cast<std::uint32_t>(name.size());
+        tag.firstContainer = static_cast<std::uint32_t>(containers.size());
+        names += name;
+
+        for (auto begin = ordinals.begin(); begin != ordinals.end();) {
+            const std::uint32_t key = *begin >> 16;
+            const auto end = std::find_if(begin, ordinals.end(),
+                                          [key](std::uint32_t o) { return o >> 16 != key; });
+            PackedContainer c{};
+            c.key = static_cast<std::uint16_t>(key);
+            c.cardinality = static_cast<std::uint32_t>(end - begin);
+            if (c.cardinality > kMaxArrayValues) {
+                c.dense = 1;
+                c.offset = static_cast<std::uint32_t>(words.size());
+                words.resize(words.size() + kWordsPerBitmap);
+                std::uint64_t* bitmap = words.data() + c.offset;
+                for (auto it = begin; it != end; ++it) {
+                    const std::uint32_t low = *it & 0xffff;
+                    bitmap[low / 64] |= std::uint64_t{1} << (low % 64);
+                }
+            } else {
+                c.offset = static_cast<std::uint32_t>(values.size());
+                for (auto it = begin; it != end; ++it) {
+                    values.push_back(static_cast<std::uint16_t>(*it & 0xffff));
+                }
+            }
+            containers.push_back(c);
+            begin = end;
+        }
+        tag.containerCount = static_cast<std::uint32_t>(containers.size()) - tag.firstContainer;
+        tags.push_back(tag);
+    }
+
+    w.put(static_cast<std::uint32_t>(tags.size()));
+    w.put(static_cast<std::uint32_t>(containers.size()));
+    w.put(static_cast<std::uint32_t>(values.size()));
+    w.put(static_cast<std::uint32_t>(words.size()));
+    w.put(static_cast<std::uint32_t>(names.size()));
+    w.align(alignof(PackedTag));
+    w.put_bytes(tags.data(), tags.size() * sizeof(PackedTag));
+    w.put_bytes(containers.data(), containers.size() * sizeof(PackedContainer));
+    w.put_bytes(values.data(), values.size() * sizeof(std::uint16_t));
+    w.align(alignof(std::uint64_t));
+    w.put_bytes(words.data(), words.size() * sizeof(std::uint64_t));
+    w.put_bytes(names.data(), names.size());
+}
+
+void TagIndex::decode(util::BinaryReader& r) {
+    const auto tagCount = r.get<std::uint32_t>();
+    const auto containerCount = r.get<std::uint32_t>();
+    const auto valueCount = r.get<std::uint32_t>();
+    const auto wordCount = r.get<std::uint32_t>();
+    const auto nameBytes = r.get<std::uint32_t>();
+    r.align(alignof(PackedTag));
+    tags_ = {r.get_array<PackedTag>(tagCount), tagCount};
+    containers_ = {r.get_array<PackedContainer>(containerCount), containerCount};
+    values_ = {r.get_array<std::uint16_t>(valueCount), valueCount};
+    r.align(alignof(std::uint64_t));
+    words_ = {r.get_array<std::uint64_t>(wordCount), wordCount};
+    names_ = {r.get_array<char>(nameBytes), nameBytes};
+
+    for (const auto& tag : tags_) {
+        if (tag.nameOffset > names_.size() || tag.nameLength > names_.size() - tag.nameOffset ||
+            tag.firstContainer > containers_.size() ||
+            tag.containerCount > containers_.size() - tag.firstContainer) {
+            throw std::runtime_error("tag index has an invalid tag");
+        }
+    }
+    for (const auto& c : containers_) {
+        const bool valid = c.dense
+            ? c.offset <= words_.size() && kWordsPerBitmap <= words_.size() - c.offset
+            : c.offset <= values_.size() && c.cardinality <= values_.size() - c.offset;
+        if (!valid) {
+            throw std::runtime_error("tag index has an invalid container");
+        }
+    }
+}
+
+TemplateSet TagIndex::lookup(std::string_view tag, std::size_t size) const {
+    TemplateSet set(size);
+    std::string folded(tag);
+    fold_case(folded);
+
+    auto name = [this](const PackedTag& t) {
+        return names_.substr(t.nameOffset, t.nameLength);
+    };
+    const auto it = std::lower_bound(tags_.begin(), tags_.end(), std::string_view(folded),
+                                     [&](const PackedTag& t, std::string_view key) {
+                                         return name(t) < key;
+                                     });
+    if (it == tags_.end() || name(*it) != folded) {
+        return set;
+    }
+
+    for (const auto& c : containers_.subspan(it->firstContainer, it->containerCount)) {
+        const std::size_t base = std::size_t{c.key} << 16;
+        if (base >= size) {
+            break;
+        }
+        if (c.dense) {
+            const std::size_t first = base / 64;
+            const std::size_t count = std::min(kWordsPerBitmap, set.words_.size() - first);
+            for (std::size_t i = 0; i < count; ++i) {
+                set.words_[first + i] |= words_[c.offset + i];
+            }
+            if (first + count == set.words_.size() && size % 64 != 0) {
+                set.words_.back() &= (std::uint64_t{1} << (size % 64)) - 1;
+            }
+        } else {
+            for (const std::uint16_t low : values_.subspan(c.offset, c.cardinality)) {
+                const std::size_t ordinal = base | low;
+                if (ordinal < size) {
+                    set.words_[ordinal / 64] |= std::uint64_t{1} << (ordinal % 64);
+                }
+            }
+        }
+    }
+    return set;
+}
+
+} // namespace cpp_hub
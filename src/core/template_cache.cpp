@@ -0,0 +1,366 @@
+// src/core/template_cache.cpp
+#include "cpp_hub/template_cache.hpp"
+#include "cpp_hub/generation_record.hpp"
+#include "cpp_hub/ignore_matcher.hpp"
+#include "cpp_hub/scan.hpp"
+#include "cpp_hub/substitution.hpp"
+#include "cpp_hub/template_walker.hpp"
+#include "cpp_hub/util/binary_io.hpp"
+#include "cpp_hub/util/fs.hpp"
+#include "cpp_hub/util/git.hpp"
+
+#include <chrono>
+
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+// Bump the trailing digit whenever the layout below changes.
+constexpr std::string_view kMagic = "CPPHUBT5";
+
+enum EntryFlags : std::uint8_t {
+    kDirectory = 1,
+    kVerbatim = 2,
+};
+
+void put_strings(util::BinaryWriter& w, const std::vector<std::string>& items) {
+    w.put(static_cast<std::uint32_t>(items.size()));
+    for (const auto& item : items) {
+        w.put_string(item);
+    }
+}
+
+std::vector<std::string> get_strings(util::BinaryReader& r) {
+    std::vector<std::string> items(r.get<std::uint32_t>());
+    for (auto& item : items) {
+        item = std::string(r.get_string());
+    }
+    return items;
+}
+
+void put_manifest(util::BinaryWriter& w, const TemplateManifest& m) {
+    w.put_string(m.schemaVersion);
+    w.put_string(m.id);
+    w.put_string(m.name);
+    w.put_string(m.version);
+    w.put_string(m.description);
+
+    w.put(static_cast<std::uint32_t>(m.variables.size()));
+    for (const auto& vd : m.variables) {
+        w.put(static_cast<std::uint8_t>(vd.type));
+        w.put_string(vd.name);
+        w.put_string(vd.prompt);
+        w.put_string(vd.defaultValue);
+        put_strings(w, vd.options);
+        w.put_string(vd.validationRegex);
+        w.put_string(vd.errorMessage);
+    }
+
+    put_strings(w, m.postGenHooks);
+
+    w.put(static_cast<std::uint32_t>(m.overlays.size()));
+    for (const auto& rule : m.overlays) {
+        w.put_string(rule.variable);
+        w.put_string(rule.equalsValue);
+        w.put_string(rule.path);
+    }
+
+    put_strings(w, m.ignore);
+}
+
+TemplateManifest get_manifest(util::BinaryReader& r) {
+    TemplateManifest m;
+    m.schemaVersion = r.get_string();
+    m.id = r.get_string();
+    m.name = r.get_string();
+    m.version = r.get_string();
+    m.description = r.get_string();
+
+    m.variables.resize(r.get<std::uint32_t>());
+    for (auto& vd : m.variables) {
+        vd.type = static_cast<VariableType>(r.get<std::uint8_t>());
+        vd.name = r.get_string();
+        vd.prompt = r.get_string();
+        vd.defaultValue = r.get_string();
+        vd.options = get_strings(r);
+        vd.validationRegex = r.get_string();
+        vd.errorMessage = r.get_string();
+    }
+
+    m.postGenHooks = get_strings(r);
+
+    m.overlays.resize(r.get<std::uint32_t>());
+    for (auto& rule : m.overlays) {
+        rule.variable = r.get_string();
+        rule.equalsValue = r.get_string();
+        rule.path = r.get_string();
+    }
+
+    m.ignore = get_strings(r);
+    return m;
+}
+
+// Locate the tokens of text that name one of the manifest's variables.
+std::vector<PackedToken> pack_tokens(
+    std::string_view text,
+    const SubstitutionTable& table,
+    const std::unordered_map<std::string_view, std::uint32_t>& keyIndex) {
+
+    std::vector<TokenSpan> spans;
+    find_tokens(text, table, spans);
+
+    std::vector<PackedToken> packed;
+    packed.reserve(spans.size());
+    for (const auto& span : spans) {
+        const std::string_view key = text.substr(span.offset + 2, span.length - 4);
+        packed.push_back({span.offset, static_cast<std::uint32_t>(span.length),
+                          keyIndex.at(key)});
+    }
+    return packed;
+}
+
+void put_tokens(util::BinaryWriter& w, const std::vector<PackedToken>& tokens) {
+    if (!tokens.empty()) {
+        w.put_bytes(tokens.data(), tokens.size() * sizeof(PackedToken));
+    }
+}
+
+} // namespace
+
+std::unique_ptr<CompiledTemplate> CompiledTemplate::load_or_build(
+    const fs::path& templateRoot,
+    const fs::path& cacheFile) {
+
+    const std::string head = util::head_commit(templateRoot);
+    if (head.empty()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CompiledTemplate> compiled(new CompiledTemplate());
+    compiled->root_ = templateRoot;
+
+    std::error_code ec;
+    if (compiled->file_.open(cacheFile, ec)) {
+        try {
+            compiled->decode(compiled->file_.view());
+            if (compiled->head_ == head && compiled->unchanged()) {
+                return compiled;
+            }
+        } catch (const std::exception&) {
+            // Corrupt or from an older cpp-hub; rebuild below.
+        }
+        compiled->file_.close();
+        compiled->keys_.clear();
+        compiled->entries_.clear();
+        compiled->stamps_.clear();
+    }
+
+    compiled->owned_ = compile(templateRoot, head);
+    compiled->decode(compiled->owned_);
+
+    if (!util::write_file_atomically(cacheFile, compiled->owned_, ec)) {
+        std::cerr << "Warning: could not write compiled template cache " << cacheFile << "\n";
+    }
+    return compiled;
+}
+
+CompiledTemplate::Stamp CompiledTemplate::stamp_of(const fs::path& path) {
+    std::error_code ec;
+    const fs::file_status status = fs::status(path, ec);
+    if (ec || !fs::exists(status)) {
+        return {};
+    }
+    Stamp stamp;
+    stamp.size = fs::is_directory(status) ? 0 : static_cast<std::int64_t>(fs::file_size(path, ec));
+    stamp.modified = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         fs::last_write_time(path, ec).time_since_epoch())
+                         .count();
+    return ec ? Stamp{} : stamp;
+}
+
+std::vector<fs::path> CompiledTemplate::stamped_paths(const fs::path& root) {
+    // The root directory's time changes when a file is added to or removed
+    // from it; subdirectories are covered by their entries.
+    return {root / "hub-manifest.json", root / std::string(kIgnoreFileName), root};
+}
+
+bool CompiledTemplate::unchanged() const {
+    const std::vector<fs::path> paths = stamped_paths(root_);
+    if (stamps_.size() != paths.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        if (stamp_of(paths[i]) != stamps_[i]) {
+            return false;
+        }
+    }
+    for (const auto& e : entries_) {
+        if (e.directory && stamp_of(root_ / fs::path(e.relPath)) != Stamp{0, e.modified}) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string CompiledTemplate::compile(const fs::path& root, const std::string& head) {
+    // Stamped before anything is read, so an edit made while compiling is
+    // noticed next time.
+    std::vector<Stamp> stamps;
+    for (const auto& path : stamped_paths(root)) {
+        stamps.push_back(stamp_of(path));
+    }
+
+    const TemplateManifest manifest = load_manifest(root / "hub-manifest.json");
+
+    // Only manifest variables can ever be substituted, so they are the keys
+    // recognized at compile time. Their values do not matter here.
+    std::unordered_map<std::string, std::string> names;
+    for (const auto& vd : manifest.variables) {
+        names.emplace(vd.name, std::string{});
+    }
+    const SubstitutionTable table(names);
+
+    std::vector<std::string> keys;
+    std::unordered_map<std::string_view, std::uint32_t> keyIndex;
+    keys.reserve(manifest.variables.size());
+    for (const auto& vd : manifest.variables) {
+        keys.push_back(vd.name);
+    }
+    for (std::uint32_t i = 0; i < keys.size(); ++i) {
+        keyIndex.emplace(keys[i], i);
+    }
+
+    // Ignored paths are left out of the compiled form altogether.
+    const IgnoreMatcher ignore(load_ignore_patterns(root, manifest));
+    std::vector<WalkEntry> walked;
+    if (!walk_template(root, walked, {}, &ignore)) {
+        throw std::runtime_error("Failed to walk template at " + root.string());
+    }
+
+    util::BinaryWriter w;
+    w.put_bytes(kMagic.data(), kMagic.size());
+    w.put_string(head);
+    w.put(static_cast<std::uint32_t>(stamps.size()));
+    for (const auto& stamp : stamps) {
+        w.put(stamp.size);
+        w.put(stamp.modified);
+    }
+    put_manifest(w, manifest);
+    put_strings(w, keys);
+    w.put(static_cast<std::uint64_t>(walked.size()));
+
+    for (const auto& entry : walked) {
+        std::uint8_t flags = entry.directory ? kDirectory : 0;
+        fs::perms perms = fs::perms::none;
+        std::uint64_t size = 0;
+        std::int64_t modified = 0;
+        std::uint64_t digest = 0;
+        std::vector<PackedToken> contentTokens;
+
+        if (entry.directory) {
+            modified = stamp_of(entry.source).modified;
+        } else {
+            std::error_code ec;
+            util::MappedFile file;
+            if (!file.open(entry.source, ec)) {
+                throw std::runtime_error("Failed to open template file " +
+                                         entry.source.string() + ": " + ec.message());
+            }
+            perms = file.permissions();
+            size = file.size();
+            modified = file.modified();
+            const ScanResult scan = scan_buffer(file.view());
+            if (!scan.binary && scan.firstToken != std::string_view::npos) {
+                contentTokens = pack_tokens(file.view(), table, keyIndex);
+            }
+            if (contentTokens.empty()) {
+                // Verbatim files are copied without being read; the digest
+                // spares the generation record reading them.
+                flags |= kVerbatim;
+                digest = content_digest(file.view());
+            }
+        }
+
+        const std::vector<PackedToken> pathTokens = pack_tokens(entry.relPath, table, keyIndex);
+
+        w.put_string(entry.relPath);
+        w.put(flags);
+        w.put(static_cast<std::uint32_t>(perms));
+        w.put(size);
+        w.put(modified);
+        w.put(digest);
+        w.put(static_cast<std::uint32_t>(pathTokens.size()));
+        w.put(static_cast<std::uint32_t>(contentTokens.size()));
+        w.align(alignof(PackedToken));
+        put_tokens(w, pathTokens);
+        put_tokens(w, contentTokens);
+    }
+
+    return w.data();
+}
+
+void CompiledTemplate::decode(std::string_view data) {
+    util::BinaryReader r(data);
+    const std::string_view magic(r.get_array<char>(kMagic.size()), kMagic.size());
+    if (magic != kMagic) {
+        throw std::runtime_error("not a compiled template");
+    }
+
+    head_ = r.get_string();
+    stamps_.resize(r.get<std::uint32_t>());
+    for (auto& stamp : stamps_) {
+        stamp.size = r.get<std::int64_t>();
+        stamp.modified = r.get<std::int64_t>();
+    }
+    manifest_ = get_manifest(r);
+
+    keys_.resize(r.get<std::uint32_t>());
+    for (auto& key : keys_) {
+        key = r.get_string();
+    }
+
+    auto check_tokens = [&](std::span<const PackedToken> tokens, std::uint64_t limit) {
+        for (const auto& t : tokens) {
+            if (t.key >= keys_.size() || t.offset > limit || t.length > limit - t.offset) {
+                throw std::runtime_error("compiled template has an invalid token");
+            }
+        }
+    };
+
+    const auto count = r.get<std::uint64_t>();
+    entries_.clear();
+    entries_.reserve(static_cast<std::size_t>(count));
+    for (std::uint64_t i = 0; i < count; ++i) {
+        CompiledEntry e{};
+        e.relPath = r.get_string();
+        const auto flags = r.get<std::uint8_t>();
+        e.directory = (flags & kDirectory) != 0;
+        e.verbatim = (flags & kVerbatim) != 0;
+        e.perms = static_cast<fs::perms>(r.get<std::uint32_t>());
+        e.size = r.get<std::uint64_t>();
+        e.modified = r.get<std::int64_t>();
+        e.digest = r.get<std::uint64_t>();
+        const auto pathCount = r.get<std::uint32_t>();
+        const auto contentCount = r.get<std::uint32_t>();
+        r.align(alignof(PackedToken));
+        e.pathTokens = {r.get_array<PackedToken>(pathCount), pathCount};
+        e.contentTokens = {r.get_array<PackedToken>(contentCount), contentCount};
+
+        check_tokens(e.pathTokens, e.relPath.size());
+        check_tokens(e.contentTokens, e.size);
+        entries_.push_back(e);
+    }
+
+    if (!r.at_end()) {
+        throw std::runtime_error("trailing data in compiled template");
+    }
+}
+
+} // namespace cpp_hub
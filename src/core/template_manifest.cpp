@@ -146,6 +146,18 @@ TemplateManifest load_manifest(const fs::path& manifestPath) {
         }
     }
 
+    if (j.contains("ignore")) {
+        if (!j["ignore"].is_array()) {
+            throw std::runtime_error("Manifest field 'ignore' must be an array of patterns.");
+        }
+        for (const auto& item : j["ignore"]) {
+            if (!item.is_string()) {
+                throw std::runtime_error("Manifest field 'ignore' must be an array of patterns.");
+            }
+            manifest.ignore.push_back(item.get<std::string>());
+        }
+    }
+
     return manifest;
 }
 
@@ -185,6 +197,26 @@ static bool validate_select_variable(const VariableDef& vd, const std::string& v
     return false;
 }
 
+bool validate_variable_value(const VariableDef& vd, std::string& value) {
+    switch (vd.type) {
+    case VariableType::String:
+        return validate_string_variable(vd, value);
+    case VariableType::Select:
+        return validate_select_variable(vd, value);
+    case VariableType::Boolean: {
+        bool b{};
+        if (!parse_bool(value, b)) {
+            std::cerr << "Invalid boolean value '" << value
+                      << "' for variable '" << vd.name << "'.\n";
+            return false;
+        }
+        value = b ? "true" : "false";
+        return true;
+    }
+    }
+    return false;
+}
+
 bool collect_variables_interactively(
     const TemplateManifest& manifest,
     bool useDefaults,
@@ -0,0 +1,280 @@
+// src/core/template_walker.cpp
+#include "cpp_hub/template_walker.hpp"
+#include "cpp_hub/ignore_matcher.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <system_error>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub {
+
+namespace {
+
+// Names skipped wherever they appear, without descending into them.
+bool is_skipped_name(std::string_view name) {
+    return name == ".git" || name == "hub-manifest.json";
+}
+
+// Shared by both walkers: the relative path is kept in one string that
+// grows and shrinks as the walk goes down and back up, so no entry needs
+// a path computed from scratch. The string starts with the ignore prefix,
+// so ignore patterns see the path from the template root.
+class WalkState {
+public:
+    WalkState(const fs::path& root, std::vector<WalkEntry>& entries,
+              const std::vector<std::string>& pruned, const IgnoreMatcher* ignore,
+              std::string_view ignorePrefix)
+        : root_(root), entries_(entries), pruned_(pruned),
+          ignore_(ignore && !ignore->empty() ? ignore : nullptr),
+          templateRoot_(ignorePrefix.empty()) {
+        if (ignore_ && !ignorePrefix.empty()) {
+            path_ = ignorePrefix;
+            base_ = path_.size() + 1;
+        }
+    }
+
+    // Make `name` the last component of the current relative path; returns
+    // false if it is pruned or ignored. The previous length is returned in
+    // `mark`.
+    bool enter(std::string_view name, bool directory, std::size_t& mark) {
+        mark = path_.size();
+        if (!path_.empty()) {
+            path_ += '/';
+        }
+        path_ += name;
+        if (std::find(pruned_.begin(), pruned_.end(), rel()) != pruned_.end() ||
+            (ignore_ && ignore_->ignored(path_, directory))) {
+            path_.resize(mark);
+            return false;
+        }
+        return true;
+    }
+
+    void leave(std::size_t mark) { path_.resize(mark); }
+
+    // Whether `name`, in the directory currently walked, is left out. Only
+    // the template root's .hubignore is read, so a nested one is generated
+    // like any other file.
+    bool skipped(std::string_view name) const {
+        return is_skipped_name(name) ||
+               (name == kIgnoreFileName && templateRoot_ && rel().empty());
+    }
+
+    void add(bool directory) {
+        const std::string_view rel = this->rel();
+        entries_.push_back({root_ / rel, std::string(rel), directory});
+    }
+
+    const fs::path& root() const { return root_; }
+    std::string_view rel() const { return std::string_view(path_).substr(base_); }
+
+private:
+    const fs::path& root_;
+    std::vector<WalkEntry>& entries_;
+    const std::vector<std::string>& pruned_;
+    const IgnoreMatcher* ignore_;
+    bool templateRoot_;    // root_ is the template root, not an overlay
+    std::string path_;     // ignore prefix, then the path relative to root_
+    std::size_t base_ = 0; // where the relative path starts in path_
+};
+
+#if defined(__linux__)
+
+struct LinuxDirent64 {
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+constexpr std::size_t kDirentBufferSize = 32 << 10;
+
+class FdGuard {
+public:
+    explicit FdGuard(int fd) : fd_(fd) {}
+    FdGuard(const FdGuard&) = delete;
+    FdGuard& operator=(const FdGuard&) = delete;
+    ~FdGuard() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+// Reads directories with getdents64 and looks entries up with fstatat,
+// both relative to the open directory, so no path is ever resolved from
+// the root again. The dirent type usually makes the fstatat unnecessary.
+class FdWalker {
+public:
+    explicit FdWalker(WalkState& state) : state_(state) {}
+
+    bool run() {
+        const int fd = ::open(state_.root().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            const int err = errno;
+            std::cerr << "Failed to open template directory " << state_.root() << ": "
+                      << std::generic_category().message(err) << "\n";
+            return false;
+        }
+        FdGuard guard(fd);
+        return walk(fd, 0);
+    }
+
+private:
+    bool walk(int dirFd, std::size_t depth) {
+        // One buffer per depth, since a listing is still being read while
+        // its subdirectories are walked.
+        if (buffers_.size() <= depth) {
+            buffers_.push_back(std::make_unique<char[]>(kDirentBufferSize));
+        }
+        char* buffer = buffers_[depth].get();
+
+        for (;;) {
+            const long n = ::syscall(SYS_getdents64, dirFd, buffer, kDirentBufferSize);
+            if (n < 0) {
+                const int err = errno;
+                std::cerr << "Failed to read directory " << (state_.root() / state_.rel())
+                          << ": " << std::generic_category().message(err) << "\n";
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            for (long off = 0; off < n;) {
+                const auto* d = reinterpret_cast<const LinuxDirent64*>(buffer + off);
+                off += d->d_reclen;
+                if (!visit(dirFd, d->d_name, d->d_type, depth)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    bool visit(int dirFd, const char* name, unsigned char type, std::size_t depth) {
+        const std::string_view nameView(name);
+        if (nameView == "." || nameView == ".." || state_.skipped(nameView)) {
+            return true;
+        }
+
+        // Symlinks are listed as what they point to but never descended
+        // into, like std::filesystem's recursive iterator does.
+        bool directory = type == DT_DIR;
+        bool descend = directory;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            struct stat st;
+            if (type == DT_UNKNOWN && ::fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                !S_ISLNK(st.st_mode)) {
+                descend = S_ISDIR(st.st_mode);
+            } else if (::fstatat(dirFd, name, &st, 0) != 0) {
+                return true; // dangling or vanished
+            }
+            directory = S_ISDIR(st.st_mode);
+            if (!directory && !S_ISREG(st.st_mode)) {
+                return true;
+            }
+        } else if (type != DT_REG && !directory) {
+            return true;
+        }
+
+        std::size_t mark = 0;
+        if (!state_.enter(nameView, directory, mark)) {
+            return true;
+        }
+        state_.add(directory);
+
+        bool ok = true;
+        if (descend) {
+            const int fd = ::openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+            if (fd >= 0) {
+                FdGuard guard(fd);
+                ok = walk(fd, depth + 1);
+            } else if (errno != EACCES) {
+                const int err = errno;
+                std::cerr << "Failed to open directory " << (state_.root() / state_.rel())
+                          << ": " << std::generic_category().message(err) << "\n";
+                ok = false;
+            }
+        }
+        state_.leave(mark);
+        return ok;
+    }
+
+    WalkState& state_;
+    std::vector<std::unique_ptr<char[]>> buffers_;
+};
+
+#else
+
+bool walk_directory(const fs::path& dir, WalkState& state) {
+    std::error_code ec;
+    fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+    if (ec) {
+        std::cerr << "Failed to read directory " << dir << ": " << ec.message() << "\n";
+        return false;
+    }
+    for (; it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (state.skipped(name)) {
+            continue;
+        }
+        const bool directory = it->is_directory(ec);
+        if (!directory && !it->is_regular_file(ec)) {
+            continue;
+        }
+        std::size_t mark = 0;
+        if (!state.enter(name, directory, mark)) {
+            continue;
+        }
+        state.add(directory);
+        const bool ok = !directory || it->is_symlink(ec) || walk_directory(it->path(), state);
+        state.leave(mark);
+        if (!ok) {
+            return false;
+        }
+    }
+    if (ec) {
+        std::cerr << "Failed to read directory " << dir << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
+bool walk_template(
+    const fs::path& root,
+    std::vector<WalkEntry>& entries,
+    const std::vector<std::string>& pruned,
+    const IgnoreMatcher* ignore,
+    std::string_view ignorePrefix) {
+
+    WalkState state(root, entries, pruned, ignore, ignorePrefix);
+#if defined(__linux__)
+    return FdWalker(state).run();
+#else
+    return walk_directory(root, state);
+#endif
+}
+
+} // namespace cpp_hub
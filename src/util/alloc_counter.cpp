@@ -0,0 +1,55 @@
+// src/util/alloc_counter.cpp
+#include "cpp_hub/util/alloc_counter.hpp"
+
+#ifdef CPP_HUB_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::uint64_t> g_allocations{0};
+} // namespace
+
+// The default array and nothrow forms all forward to these.
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    for (;;) {
+        if (void* p = std::malloc(size == 0 ? 1 : size)) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+namespace cpp_hub::util {
+
+bool counting_heap_allocations() {
+#ifdef CPP_HUB_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::uint64_t heap_allocations() {
+#ifdef CPP_HUB_COUNT_ALLOCATIONS
+    return g_allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+} // namespace cpp_hub::util
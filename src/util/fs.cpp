@@ -2,8 +2,24 @@
 #include "cpp_hub/util/fs.hpp"
 #include <cstdlib>
 #include <iostream>
+#include <string>
 #include <system_error>
 
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
 namespace fs = std::filesystem;
 
 namespace cpp_hub::util {
@@ -41,4 +57,262 @@ bool ensure_directory(const fs::path& dir) {
     return true;
 }
 
-} // namespace cpp_hub::util
\ No newline at end of file
+#ifndef _WIN32
+static void set_errno_error(std::error_code& ec) {
+    ec.assign(errno, std::generic_category());
+}
+
+static bool write_all(int fd, const char* data, size_t size, std::error_code& ec) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            set_errno_error(ec);
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Portable last resort for copy_file_fast: read/write through a stack buffer.
+static bool copy_by_read_write(int in, int out, std::error_code& ec) {
+    char buf[64 * 1024];
+    while (true) {
+        ssize_t n = ::read(in, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            set_errno_error(ec);
+            return false;
+        }
+        if (n == 0) return true;
+        if (!write_all(out, buf, static_cast<size_t>(n), ec)) return false;
+    }
+}
+
+#ifdef __linux__
+// Errors after which a kernel copy primitive is simply unsupported for this
+// pair of files and the next strategy should be tried.
+static bool is_unsupported(int err) {
+    return err == ENOSYS || err == EXDEV || err == EINVAL ||
+           err == EOPNOTSUPP || err == ENOTSUP || err == EBADF;
+}
+
+// Copy `size` bytes with copy_file_range, then sendfile. Returns false with
+// ec unset if neither could copy anything, so the caller can fall back.
+static bool copy_in_kernel(int in, int out, off_t size, std::error_code& ec) {
+    off_t copied = 0;
+    bool useCopyRange = true;
+    while (copied < size) {
+        ssize_t n = -1;
+        if (useCopyRange) {
+            n = ::copy_file_range(in, nullptr, out, nullptr,
+                                  static_cast<size_t>(size - copied), 0);
+            if (n < 0 && copied == 0 && is_unsupported(errno)) {
+                useCopyRange = false;
+                continue;
+            }
+        } else {
+            n = ::sendfile(out, in, nullptr, static_cast<size_t>(size - copied));
+            if (n < 0 && copied == 0 && is_unsupported(errno)) {
+                return false;
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            set_errno_error(ec);
+            return false;
+        }
+        if (n == 0) break; // source shrank underneath us
+        copied += n;
+    }
+    return true;
+}
+#endif
+#endif
+
+bool write_file(const fs::path& dest, std::string_view data, fs::perms perms,
+                std::error_code& ec) {
+    ec.clear();
+#ifdef _WIN32
+    {
+        std::ofstream out(dest, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+    }
+    fs::permissions(dest, perms, ec);
+    return !ec;
+#else
+    const auto mode = static_cast<mode_t>(perms) & 07777;
+    const int fd = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd < 0) {
+        set_errno_error(ec);
+        return false;
+    }
+    bool ok = write_all(fd, data.data(), data.size(), ec);
+    if (ok && ::fchmod(fd, mode) != 0) {
+        set_errno_error(ec);
+        ok = false;
+    }
+    if (::close(fd) != 0 && ok) {
+        set_errno_error(ec);
+        ok = false;
+    }
+    return ok;
+#endif
+}
+
+bool write_file_atomically(const fs::path& dest, std::string_view data, std::error_code& ec) {
+    fs::create_directories(dest.parent_path(), ec);
+
+    fs::path tmp = dest;
+#ifdef _WIN32
+    tmp += ".tmp";
+#else
+    tmp += ".tmp." + std::to_string(::getpid());
+#endif
+    if (!write_file(tmp, data, fs::perms::owner_read | fs::perms::owner_write |
+                                   fs::perms::group_read | fs::perms::others_read, ec)) {
+        return false;
+    }
+    fs::rename(tmp, dest, ec);
+    if (ec) {
+        std::error_code ignored;
+        fs::remove(tmp, ignored);
+        return false;
+    }
+    return true;
+}
+
+OutputFile::~OutputFile() {
+    std::error_code ec;
+    close(ec);
+}
+
+bool OutputFile::open(const fs::path& dest, fs::perms perms, std::error_code& ec) {
+    ec.clear();
+    close(ec);
+#ifdef _WIN32
+    auto* out = new std::ofstream(dest, std::ios::binary | std::ios::trunc);
+    if (!*out) {
+        delete out;
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    stream_ = out;
+    path_ = dest;
+    perms_ = perms;
+    return true;
+#else
+    const auto mode = static_cast<mode_t>(perms) & 07777;
+    fd_ = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd_ < 0) {
+        set_errno_error(ec);
+        return false;
+    }
+    if (::fchmod(fd_, mode) != 0) {
+        set_errno_error(ec);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool OutputFile::write(std::string_view data, std::error_code& ec) {
+#ifdef _WIN32
+    auto* out = static_cast<std::ofstream*>(stream_);
+    if (!out || !out->write(data.data(), static_cast<std::streamsize>(data.size()))) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+#else
+    if (fd_ < 0) {
+        ec = std::make_error_code(std::errc::bad_file_descriptor);
+        return false;
+    }
+    return write_all(fd_, data.data(), data.size(), ec);
+#endif
+}
+
+bool OutputFile::close(std::error_code& ec) {
+#ifdef _WIN32
+    auto* out = static_cast<std::ofstream*>(stream_);
+    if (!out) return true;
+    out->close();
+    const bool ok = !out->fail();
+    delete out;
+    stream_ = nullptr;
+    if (!ok) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    fs::permissions(path_, perms_, ec);
+    return !ec;
+#else
+    if (fd_ < 0) return true;
+    const int rc = ::close(fd_);
+    fd_ = -1;
+    if (rc != 0) {
+        set_errno_error(ec);
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool copy_file_fast(const fs::path& src, const fs::path& dest, std::error_code& ec) {
+    ec.clear();
+#ifdef _WIN32
+    return fs::copy_file(src, dest, fs::copy_options::overwrite_existing, ec);
+#else
+    const int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        set_errno_error(ec);
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(in, &st) != 0) {
+        set_errno_error(ec);
+        ::close(in);
+        return false;
+    }
+    const mode_t mode = st.st_mode & 07777;
+    const int out = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (out < 0) {
+        set_errno_error(ec);
+        ::close(in);
+        return false;
+    }
+
+    bool ok = false;
+#ifdef __linux__
+#ifdef FICLONE
+    ok = st.st_size > 0 && ::ioctl(out, FICLONE, in) == 0;
+#endif
+    if (!ok) {
+        ok = copy_in_kernel(in, out, st.st_size, ec);
+    }
+#endif
+    if (!ok && !ec) {
+        ok = copy_by_read_write(in, out, ec);
+    }
+    if (ok && ::fchmod(out, mode) != 0) {
+        set_errno_error(ec);
+        ok = false;
+    }
+    ::close(in);
+    if (::close(out) != 0 && ok) {
+        set_errno_error(ec);
+        ok = false;
+    }
+    return ok;
+#endif
+}
+
+} // namespace cpp_hub::util
@@ -0,0 +1,88 @@
+// src/util/git.cpp
+#include "cpp_hub/util/git.hpp"
+#include "cpp_hub/util/process.hpp"
+#include "cpp_hub/util/string_utils.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub::util {
+
+static bool read_first_line(const fs::path& p, std::string& out) {
+    std::ifstream in(p);
+    if (!in || !std::getline(in, out)) {
+        return false;
+    }
+    out = trim(out);
+    return true;
+}
+
+// Resolve the git directory of a work tree; `.git` may be a directory or a
+// "gitdir: <path>" file (worktrees, submodules).
+static fs::path git_dir(const fs::path& repo) {
+    fs::path dotGit = repo / ".git";
+    std::error_code ec;
+    if (fs::is_directory(dotGit, ec)) {
+        return dotGit;
+    }
+    std::string line;
+    if (read_first_line(dotGit, line) && line.rfind("gitdir:", 0) == 0) {
+        fs::path dir = trim(line.substr(7));
+        return dir.is_relative() ? repo / dir : dir;
+    }
+    return {};
+}
+
+std::string head_commit(const fs::path& repo) {
+    const fs::path gitDir = git_dir(repo);
+    if (gitDir.empty()) {
+        return {};
+    }
+
+    std::string head;
+    if (!read_first_line(gitDir / "HEAD", head)) {
+        return {};
+    }
+    if (head.rfind("ref:", 0) != 0) {
+        return head; // detached HEAD
+    }
+
+    const std::string ref = trim(head.substr(4));
+    std::string commit;
+    if (read_first_line(gitDir / ref, commit)) {
+        return commit;
+    }
+
+    std::ifstream packed(gitDir / "packed-refs");
+    std::string line;
+    while (std::getline(packed, line)) {
+        if (line.empty() || line[0] == '#' || line[0] == '^') {
+            continue;
+        }
+        const auto space = line.find(' ');
+        if (space != std::string::npos && trim(line.substr(space + 1)) == ref) {
+            return line.substr(0, space);
+        }
+    }
+    return {};
+}
+
+std::int64_t head_commit_time(const fs::path& repo) {
+    if (git_dir(repo).empty()) {
+        return -1;
+    }
+    std::string out;
+    if (!capture_command("git -C \"" + repo.string() + "\" log -1 --format=%ct HEAD", out)) {
+        return -1;
+    }
+    try {
+        return std::stoll(trim(out));
+    } catch (const std::logic_error&) {
+        return -1;
+    }
+}
+
+} // namespace cpp_hub::util
@@ -0,0 +1,124 @@
+// src/util/mapped_file.cpp
+#include "cpp_hub/util/mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace cpp_hub::util {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        buffer_ = std::move(other.buffer_);
+        data_ = other.mapped_ ? other.data_ : buffer_.data();
+        size_ = other.size_;
+        perms_ = other.perms_;
+        modified_ = other.modified_;
+        open_ = other.open_;
+        mapped_ = other.mapped_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+}
+
+bool MappedFile::open(const fs::path& path, std::error_code& ec) {
+    close();
+    ec.clear();
+
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    buffer_ = buffer.str();
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    perms_ = fs::status(path, ec).permissions();
+    if (!ec) {
+        modified_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        fs::last_write_time(path, ec).time_since_epoch())
+                        .count();
+    }
+    open_ = !ec;
+    return open_;
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ec.assign(errno, std::generic_category());
+        ::close(fd);
+        return false;
+    }
+    perms_ = static_cast<fs::perms>(st.st_mode & 07777);
+    size_ = static_cast<std::size_t>(st.st_size);
+#ifdef __APPLE__
+    const struct timespec& mtime = st.st_mtimespec;
+#else
+    const struct timespec& mtime = st.st_mtim;
+#endif
+    modified_ = static_cast<std::int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ec.assign(errno, std::generic_category());
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        data_ = static_cast<const char*>(p);
+        mapped_ = true;
+    }
+
+    ::close(fd);
+    open_ = true;
+    return true;
+#endif
+}
+
+} // namespace cpp_hub::util
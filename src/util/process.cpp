@@ -1,17 +1,21 @@
 // src/util/process.cpp
 #include "cpp_hub/util/process.hpp"
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <string>
 
 namespace fs = std::filesystem;
 
 namespace cpp_hub::util {
 
 bool run_command(const std::string& cmd) {
-    std::cout << "$ " << cmd << "\n";
+    // One write per line, so commands run from several threads do not
+    // interleave their echoes.
+    std::cout << ("$ " + cmd + "\n");
     int rc = std::system(cmd.c_str());
     if (rc != 0) {
-        std::cerr << "Command failed with code " << rc << ": " << cmd << "\n";
+        std::cerr << ("Command failed with code " + std::to_string(rc) + ": " + cmd + "\n");
         return false;
     }
     return true;
@@ -47,4 +51,25 @@ bool run_command_in_dir(const std::string& cmd, const fs::path& dir) {
     return true;
 }
 
+bool capture_command(const std::string& cmd, std::string& output) {
+#ifdef _WIN32
+    std::FILE* pipe = ::_popen(cmd.c_str(), "r");
+#else
+    std::FILE* pipe = ::popen(cmd.c_str(), "r");
+#endif
+    if (!pipe) {
+        return false;
+    }
+    output.clear();
+    char buffer[4096];
+    for (std::size_t n; (n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0;) {
+        output.append(buffer, n);
+    }
+#ifdef _WIN32
+    return ::_pclose(pipe) == 0;
+#else
+    return ::pclose(pipe) == 0;
+#endif
+}
+
 } // namespace cpp_hub::util
\ No newline at end of file
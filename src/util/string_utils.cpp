@@ -25,14 +25,18 @@ std::string trim(const std::string& s) {
     return s.substr(start, end - start + 1);
 }
 
-bool iequals(const std::string& a, const std::string& b) {
-    return to_lower(a) == to_lower(b);
+static bool iequal_chars(char a, char b) {
+    return std::tolower(static_cast<unsigned char>(a)) ==
+           std::tolower(static_cast<unsigned char>(b));
 }
 
-bool icontains(const std::string& text, const std::string& sub) {
-    std::string t = to_lower(text);
-    std::string s = to_lower(sub);
-    return t.find(s) != std::string::npos;
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), iequal_chars);
+}
+
+bool icontains(std::string_view text, std::string_view sub) {
+    return std::search(text.begin(), text.end(), sub.begin(), sub.end(), iequal_chars) !=
+           text.end() || sub.empty();
 }
 
 bool parse_bool(const std::string& text, bool& out) {
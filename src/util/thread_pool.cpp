@@ -0,0 +1,122 @@
+// src/util/thread_pool.cpp
+#include "cpp_hub/util/thread_pool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace cpp_hub::util {
+
+namespace {
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::size_t> items;
+
+    bool pop_front(std::size_t& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        out = items.front();
+        items.pop_front();
+        return true;
+    }
+
+    bool steal_back(std::size_t& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        out = items.back();
+        items.pop_back();
+        return true;
+    }
+};
+
+} // namespace
+
+unsigned default_jobs() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void parallel_for(
+    std::size_t count,
+    unsigned jobs,
+    const std::function<void(std::size_t)>& task) {
+
+    if (jobs == 0) {
+        jobs = default_jobs();
+    }
+    const std::size_t workers = std::min<std::size_t>(jobs, count);
+
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    queues.reserve(workers);
+    for (std::size_t w = 0; w < workers; ++w) {
+        auto q = std::make_unique<WorkQueue>();
+        const std::size_t begin = count * w / workers;
+        const std::size_t end = count * (w + 1) / workers;
+        for (std::size_t i = begin; i < end; ++i) {
+            q->items.push_back(i);
+        }
+        queues.push_back(std::move(q));
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+
+    // No task ever enqueues more work, so once a worker finds every queue
+    // empty there is nothing left for it to do.
+    auto worker = [&](std::size_t self) {
+        std::size_t index = 0;
+        while (true) {
+            bool found = queues[self]->pop_front(index);
+            for (std::size_t k = 1; !found && k < workers; ++k) {
+                found = queues[(self + k) % workers]->steal_back(index);
+            }
+            if (!found) {
+                return;
+            }
+            try {
+                task(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+            }
+        }
+    };
+
+    // If the system refuses more threads, carry on with those already
+    // started: workers steal from every queue, including the queues of
+    // workers that never started, so all tasks still run.
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t w = 1; w < workers; ++w) {
+        try {
+            threads.emplace_back(worker, w);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    worker(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+} // namespace cpp_hub::util
@@ -0,0 +1,141 @@
+// tests/cpp_hub_tests.cpp
+#include "cpp_hub/ignore_matcher.hpp"
+#include "cpp_hub/registry_delta.hpp"
+#include "cpp_hub/substitution.hpp"
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace cpp_hub;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+            ++failures;                                                          \
+        }                                                                        \
+    } while (false)
+
+void test_glob_match() {
+    CHECK(glob_match("*.log", "build.log"));
+    CHECK(glob_match("*.log", ".log"));
+    CHECK(!glob_match("*.log", "build.log.txt"));
+    CHECK(!glob_match("*.log", "logs/build.log"));
+
+    CHECK(glob_match("file?.txt", "file1.txt"));
+    CHECK(!glob_match("file?.txt", "file.txt"));
+    CHECK(!glob_match("a?b", "a/b"));
+
+    CHECK(glob_match("[abc].cpp", "b.cpp"));
+    CHECK(!glob_match("[abc].cpp", "d.cpp"));
+    CHECK(glob_match("[a-c].cpp", "c.cpp"));
+    CHECK(glob_match("[!a-c].cpp", "d.cpp"));
+    CHECK(!glob_match("[!a-c].cpp", "a.cpp"));
+
+    CHECK(glob_match("src/**/*.tmp", "src/x.tmp"));
+    CHECK(glob_match("src/**/*.tmp", "src/a/b/x.tmp"));
+    CHECK(!glob_match("src/**/*.tmp", "lib/a/x.tmp"));
+    CHECK(glob_match("**/build", "build"));
+    CHECK(glob_match("**/build", "a/b/build"));
+    CHECK(glob_match("docs/**", "docs/a/b.md"));
+
+    CHECK(glob_match("", ""));
+    CHECK(!glob_match("", "a"));
+    CHECK(glob_match("*", ""));
+}
+
+std::string chunked(std::string_view text, const SubstitutionTable& table, std::size_t size) {
+    StreamingSubstitution stream(table);
+    std::string out;
+    for (std::size_t pos = 0; pos < text.size(); pos += size) {
+        stream.feed(text.substr(pos, size), out);
+    }
+    stream.finish(out);
+    return out;
+}
+
+void test_substitution() {
+    const std::unordered_map<std::string, std::string> values{
+        {"name", "demo"}, {"project_name", "MyProject"}, {"x", ""}};
+    const SubstitutionTable table(values);
+
+    CHECK(apply_substitutions("{{name}}", table) == "demo");
+    CHECK(apply_substitutions("a{{x}}b", table) == "ab");
+    CHECK(apply_substitutions("{{unknown}} {{name", table) == "{{unknown}} {{name");
+    CHECK(apply_substitutions("{{{name}}}", table) == "{demo}");
+
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "line " + std::to_string(i) + " {{name}}/{{project_name}}{{x}} {{nope}} {{";
+        text += (i % 7 == 0) ? "{{" : "}}";
+    }
+    const std::string expected = apply_substitutions(text, table);
+
+    // Every piece substituted on its own joins up to the whole-text result.
+    for (std::size_t target : {1, 2, 5, 17, 64, 1000, 100000}) {
+        const std::vector<std::size_t> cuts = split_at_safe_boundaries(text, table, target);
+        CHECK(cuts.front() == 0);
+        CHECK(cuts.back() == text.size());
+        std::string joined;
+        for (std::size_t i = 1; i < cuts.size(); ++i) {
+            CHECK(cuts[i - 1] < cuts[i]);
+            joined += apply_substitutions(
+                std::string_view(text).substr(cuts[i - 1], cuts[i] - cuts[i - 1]), table);
+        }
+        CHECK(joined == expected);
+    }
+    CHECK(split_at_safe_boundaries("", table, 16) == (std::vector<std::size_t>{0, 0}));
+
+    // Chunk sizes that cut tokens anywhere give the same output.
+    for (std::size_t size : {1, 2, 3, 7, 13, 64, 4096}) {
+        CHECK(chunked(text, table, size) == expected);
+    }
+    CHECK(chunked("{{na", table, 2) == "{{na");
+    CHECK(chunked("", table, 1).empty());
+}
+
+void test_diff_template_sources() {
+    const std::vector<TemplateSource> before{
+        {"alpha", "https://a", "v1"},
+        {"beta", "https://b", "v1"},
+        {"gamma", "https://g", "v1"},
+        {"zeta", "https://z", "v1"},
+    };
+    const std::vector<TemplateSource> after{
+        {"alpha", "https://a", "v1"},
+        {"beta", "https://b2", "v1"},
+        {"delta", "https://d", "v1"},
+        {"gamma", "https://g", "v2"},
+    };
+
+    const RegistryDelta delta = diff_template_sources(before, after);
+    CHECK(delta.added.size() == 1 && delta.added[0].id == "delta");
+    CHECK(delta.removed == std::vector<std::string>{"zeta"});
+    CHECK(delta.relocated.size() == 1 && delta.relocated[0].url == "https://b2");
+    CHECK(delta.revised.size() == 1 && delta.revised[0].id == "gamma" &&
+          delta.revised[0].revision == "v2");
+
+    CHECK(diff_template_sources(before, before).empty());
+    CHECK(diff_template_sources({}, after).added.size() == after.size());
+    CHECK(diff_template_sources(before, {}).removed.size() == before.size());
+}
+
+} // namespace
+
+int main() {
+    test_glob_match();
+    test_substitution();
+    test_diff_template_sources();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}